@@ -266,4 +266,869 @@ Henry is born.
 Inside copy constructor
 Inside operator=()
 
-*/
\ No newline at end of file
+*/
+
+
+
+
+/****************************************************** EXAMPLE 6 ******************************************************************/
+
+// Telling containers that the compiler generated copy is "just bytes" : a trivially relocatable trait.
+
+/*
+When vector<Dog2> grows, it allocates a new buffer, move-constructs every Dog2 into it, and destroys the old ones, one
+element at a time. For many classes that whole dance is equivalent to a memcpy of the old buffer followed by forgetting
+it ("relocation"), but the library cannot know that :-
+	- is_trivially_copyable<T> is only true if all 4 compiler generated functions are trivial. Dog2 has a user-defined
+	  destructor (and a string member), so it is false, even though nothing in Dog2 points at its own address.
+	- There is no standard trait (yet) for "moving this object to a new address and not destroying the old one is the same
+	  as memcpy". It is proposed for C++26 as trivial relocation.
+
+So we add our own trait, the same one as Example 6 of 13_Resource_Managing_Class.cpp :-
+	1) is_trivially_relocatable<T> is true for trivially copyable types (e.g. collar below, automatically).
+	2) A class opts in by specializing it. Dog2's specialization forwards to its string member's, so it is only true on
+	   the libraries where string itself is relocatable.
+	3) RelocVector<T> uses the trait : realloc() to grow, memmove() to insert/erase in the middle, and a batched
+	   append_n() that checks capacity once. Types without the trait get the normal element-by-element path.
+
+Careful :- Dog2 below declares a destructor, so the compiler does NOT generate a move constructor for it (a 5th function
+that the 4 above do not mention). vector<Dog2> therefore copies every name when it grows.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using namespace std;
+
+template <typename T>
+struct is_trivially_relocatable : is_trivially_copyable<T> {};	// Opt-in trait : true for trivially copyable types,
+																// and for any class that specializes it.
+
+// Library types. unique_ptr is a single pointer. std::string depends on the library : libstdc++ keeps a pointer into its
+// own small-string buffer, so a memcpy'd string would point into the old object. libc++ does not.
+template <typename T, typename D>
+struct is_trivially_relocatable<unique_ptr<T, D>> : is_trivially_relocatable<D> {};
+#ifdef _LIBCPP_VERSION
+template <> struct is_trivially_relocatable<string> : true_type {};
+#endif
+
+template <typename T>
+class RelocVector
+{
+private:
+	T* m_data = nullptr;
+	size_t m_size = 0;
+	size_t m_cap = 0;
+
+	RelocVector(const RelocVector&) = delete;
+	RelocVector& operator=(const RelocVector&) = delete;
+
+	void growTo(size_t cap)
+	{
+		if constexpr (is_trivially_relocatable<T>::value && alignof(T) <= alignof(max_align_t))
+		{
+			void* p = realloc(static_cast<void*>(m_data), cap * sizeof(T));	// may grow in place, or do the memcpy itself
+			if(!p)
+				throw bad_alloc();
+			m_data = static_cast<T*>(p);
+		}
+		else
+		{
+			T* p = static_cast<T*>(malloc(cap * sizeof(T)));		// what std::vector does : move if that cannot throw,
+			if(!p)													// otherwise copy, and only destroy the old elements
+				throw bad_alloc();									// once all the new ones exist (strong guarantee)
+			size_t i = 0;
+			try
+			{
+				for(; i < m_size; ++i)
+					new(p + i) T(std::move_if_noexcept(m_data[i]));
+			}
+			catch(...)
+			{
+				while(i-- > 0)
+					p[i].~T();
+				free(p);
+				throw;
+			}
+			for(i = 0; i < m_size; ++i)
+				m_data[i].~T();
+			free(m_data);
+			m_data = p;
+		}
+		m_cap = cap;
+	}
+
+	void makeRoom(size_t extra)
+	{
+		if(m_size + extra > m_cap)
+			growTo(max(m_size + extra, m_cap * 2));
+	}
+
+public:
+	using value_type = T;
+
+	RelocVector() {}
+
+	~RelocVector()
+	{
+		clear();
+		free(m_data);
+	}
+
+	size_t size() const { return m_size; }
+	T& operator[](size_t i) { return m_data[i]; }
+	const T& operator[](size_t i) const { return m_data[i]; }
+	T* begin() { return m_data; }
+	T* end() { return m_data + m_size; }
+
+	void reserve(size_t cap)
+	{
+		if(cap > m_cap)
+			growTo(cap);
+	}
+
+	template <typename... Args>
+	T& emplace_back(Args&&... args)
+	{
+		makeRoom(1);
+		T* p = new(m_data + m_size) T(std::forward<Args>(args)...);
+		++m_size;
+		return *p;
+	}
+
+	void push_back(const T& value) { emplace_back(value); }
+	void push_back(T&& value) { emplace_back(std::move(value)); }
+
+	// Batched construction : one capacity check, then n copies. For trivially copyable T, doubling memcpy.
+	void append_n(size_t n, const T& proto)
+	{
+		if(!n)
+			return;
+		makeRoom(n);
+		T* dst = m_data + m_size;
+		if constexpr (is_trivially_copyable<T>::value)
+		{
+			memcpy(static_cast<void*>(dst), static_cast<const void*>(&proto), sizeof(T));
+			for(size_t done = 1; done < n; done *= 2)
+				memcpy(static_cast<void*>(dst + done), static_cast<const void*>(dst), min(done, n - done) * sizeof(T));
+			m_size += n;
+		}
+		else
+		{
+			for(size_t i = 0; i < n; ++i, ++m_size)		// m_size tracks progress, so a throwing copy leaks nothing
+				new(dst + i) T(proto);
+		}
+	}
+
+	void insert(const T* where, T value)
+	{
+		const size_t pos = where - m_data;						// before makeRoom() : realloc() may move m_data
+		makeRoom(1);
+		if constexpr (is_trivially_relocatable<T>::value)		// bulk relocation : shift the tail with one memmove
+		{
+			memmove(static_cast<void*>(m_data + pos + 1), static_cast<const void*>(m_data + pos), (m_size - pos) * sizeof(T));
+			new(m_data + pos) T(std::move(value));
+			++m_size;
+		}
+		else if(pos == m_size)
+			emplace_back(std::move(value));
+		else
+		{
+			new(m_data + m_size) T(std::move(m_data[m_size - 1]));
+			++m_size;
+			move_backward(m_data + pos, m_data + m_size - 2, m_data + m_size - 1);
+			m_data[pos] = std::move(value);
+		}
+	}
+
+	void erase(const T* where)
+	{
+		const size_t pos = where - m_data;
+		if constexpr (is_trivially_relocatable<T>::value)
+		{
+			m_data[pos].~T();
+			memmove(static_cast<void*>(m_data + pos), static_cast<const void*>(m_data + pos + 1), (m_size - pos - 1) * sizeof(T));
+		}
+		else
+		{
+			move(m_data + pos + 1, m_data + m_size, m_data + pos);
+			m_data[m_size - 1].~T();
+		}
+		--m_size;
+	}
+
+	void clear()
+	{
+		for(size_t i = 0; i < m_size; ++i)
+			m_data[i].~T();
+		m_size = 0;
+	}
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The lesson's types, without the printing.
+
+class collar
+{
+public:
+	int size = 0;
+	int color = 0;
+};
+
+static_assert(is_trivially_relocatable<collar>::value, "compiler generated everything : automatically relocatable");
+
+class Dog2												// Example 1's Dog2 : string name, user-defined destructor
+{
+public:
+	string m_name;
+	collar m_collar;
+
+	Dog2(string name = "Bob"):m_name(std::move(name)) {}
+	~Dog2() {}
+};
+
+template <>
+struct is_trivially_relocatable<Dog2> : is_trivially_relocatable<string> {};	// true with libc++, false with libstdc++
+
+class Dog2P												// Same Dog2, but the name is owned through a unique_ptr
+{
+public:
+	unique_ptr<string> m_name;
+	collar m_collar;
+
+	Dog2P(string name = "Bob"):m_name(new string(std::move(name))) {}
+	Dog2P(Dog2P&&) = default;							// the destructor below would suppress them otherwise
+	Dog2P& operator=(Dog2P&&) = default;
+	~Dog2P() {}
+};
+
+template <>
+struct is_trivially_relocatable<Dog2P> : true_type {};	// a unique_ptr and two ints : memcpy + forget is a valid move
+
+template <typename Container>
+double growMs(size_t n, const char* name)
+{
+	auto start = chrono::steady_clock::now();
+	{
+		Container dogs;
+		for(size_t i = 0; i < n; ++i)
+			dogs.emplace_back(name);
+	}
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Container>
+double reserveMs(size_t n)								// one growth of a full buffer of n dogs, nothing else
+{
+	Container dogs;
+	for(size_t i = 0; i < n; ++i)
+		dogs.emplace_back("Henry");
+	auto start = chrono::steady_clock::now();
+	dogs.reserve(2 * n);
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename Container>
+double middleMs(size_t n, size_t ops)					// insert and erase in the middle of n dogs, ops times
+{
+	Container dogs;
+	for(size_t i = 0; i < n; ++i)
+		dogs.emplace_back("Henry");
+	auto start = chrono::steady_clock::now();
+	for(size_t k = 0; k < ops; ++k)
+	{
+		dogs.insert(dogs.begin() + n / 2, typename Container::value_type("Rex"));
+		dogs.erase(dogs.begin() + n / 3);
+	}
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+
+	cout<<"Dog2  relocatable : "<<is_trivially_relocatable<Dog2>::value<<endl;
+	cout<<"Dog2P relocatable : "<<is_trivially_relocatable<Dog2P>::value<<endl;
+
+	cout<<"vector<Dog2>       growth : "<<growMs<vector<Dog2>>(N, "Henry")<<" ms"<<endl;
+	cout<<"RelocVector<Dog2>  growth : "<<growMs<RelocVector<Dog2>>(N, "Henry")<<" ms"<<endl;
+	cout<<"vector<Dog2P>      growth : "<<growMs<vector<Dog2P>>(N, "Henry")<<" ms"<<endl;
+	cout<<"RelocVector<Dog2P> growth : "<<growMs<RelocVector<Dog2P>>(N, "Henry")<<" ms"<<endl;
+
+	cout<<"vector<Dog2>       reserve(2N) : "<<reserveMs<vector<Dog2>>(N)<<" ms"<<endl;
+	cout<<"RelocVector<Dog2>  reserve(2N) : "<<reserveMs<RelocVector<Dog2>>(N)<<" ms"<<endl;
+	cout<<"vector<Dog2P>      reserve(2N) : "<<reserveMs<vector<Dog2P>>(N)<<" ms"<<endl;
+	cout<<"RelocVector<Dog2P> reserve(2N) : "<<reserveMs<RelocVector<Dog2P>>(N)<<" ms"<<endl;
+
+	const size_t M = 100000;							// insert + erase in the middle of 100k dogs, N / 1000 times
+	cout<<"vector<Dog2>       insert/erase : "<<middleMs<vector<Dog2>>(M, N / 1000)<<" ms"<<endl;
+	cout<<"RelocVector<Dog2>  insert/erase : "<<middleMs<RelocVector<Dog2>>(M, N / 1000)<<" ms"<<endl;
+	cout<<"vector<Dog2P>      insert/erase : "<<middleMs<vector<Dog2P>>(M, N / 1000)<<" ms"<<endl;
+	cout<<"RelocVector<Dog2P> insert/erase : "<<middleMs<RelocVector<Dog2P>>(M, N / 1000)<<" ms"<<endl;
+
+	auto t0 = chrono::steady_clock::now();
+	{
+		vector<collar> v;
+		for(size_t i = 0; i < N; ++i)
+			v.push_back(collar{ 3, 4 });
+	}
+	auto t1 = chrono::steady_clock::now();
+	{
+		RelocVector<collar> v;
+		v.append_n(N, collar{ 3, 4 });
+	}
+	auto t2 = chrono::steady_clock::now();
+	cout<<"collars : push_back loop "<<chrono::duration<double, milli>(t1 - t0).count()<<" ms, append_n "
+		<<chrono::duration<double, milli>(t2 - t1).count()<<" ms"<<endl;
+	return 0;
+}
+
+/*
+Output (g++ -O2, libstdc++, N = 10M, numbers vary by machine) :-
+
+Dog2  relocatable : 0
+Dog2P relocatable : 1
+vector<Dog2>       growth : 1176.65 ms
+RelocVector<Dog2>  growth : 1177.06 ms
+vector<Dog2P>      growth : 1279.73 ms
+RelocVector<Dog2P> growth : 945.377 ms
+vector<Dog2>       reserve(2N) : 536.47 ms
+RelocVector<Dog2>  reserve(2N) : 361.519 ms
+vector<Dog2P>      reserve(2N) : 92.5389 ms
+RelocVector<Dog2P> reserve(2N) : 0.635206 ms
+vector<Dog2>       insert/erase : 9862.6 ms
+RelocVector<Dog2>  insert/erase : 8893.76 ms
+vector<Dog2P>      insert/erase : 1687.37 ms
+RelocVector<Dog2P> insert/erase : 613.956 ms
+collars : push_back loop 51.4942 ms, append_n 10.8215 ms
+
+	Relocation only pays where moving the elements is the whole cost, and only for a relocatable type (Dog2P) :-
+		- one growth of a full buffer (reserve(2N)) : realloc() remaps the pages of the big block instead of moving
+		  10M Dog2Ps one by one, under 1 ms against ~100 ms,
+		- insert / erase in the middle : one memmove of the tail instead of a move assignment per element, ~2.7x.
+	Filling the containers with emplace_back ("growth") shows no reliable gain : every dog allocates its name, and 10M
+	allocations cost far more than the ~24 growths. Dog2 is not relocatable with libstdc++ (its string points into
+	itself), so RelocVector<Dog2> copies every name like vector<Dog2> does, and the small differences between the two
+	are malloc() against operator new, run to run noise. append_n() wins for the trivially copyable collars because it
+	checks capacity once and copies with a few large memcpy calls, not because of relocation.
+
+Note :-
+	Only specialize is_trivially_relocatable for a class whose members are all relocatable and that holds no pointer
+	into itself. The compiler checks neither, which is why Dog2 forwards to string's trait instead of saying true_type.
+*/
+
+
+
+/****************************************************** EXAMPLE 7 ******************************************************************/
+
+// Memberwise serialization, generated at compile time the way the memberwise copy constructor is.
+
+/*
+The compiler generated copy constructor visits "each member of rhs" in declaration order. A binary serializer does the
+same walk, but C++ cannot list a class's members by itself (no reflection yet), so we list them once, in a constexpr
+field descriptor :-
+
+	template <> struct Fields<Rational> { static constexpr auto list = make_tuple(&Rational::num, &Rational::den); };
+
+From that list, encode()/decode() are expanded at compile time into a straight sequence of fixed size memcpy's (one per
+member, no loop, no branch on the type) and one length-prefixed copy per string :-
+	1) A type whose bytes ARE its value (trivially copyable, no padding : Rational, collar) is a single memcpy, and an
+	   array of them is ONE memcpy for the whole array.
+	2) encodeAll() first adds up the exact encoded size of the whole array, then writes into one contiguous buffer
+	   (one allocation, no growth checks per member).
+	3) Members that are themselves described (Dog2's collar) are serialized recursively.
+The format is native endian and meant for the same kind of machine reading it back (snapshots, caches, IPC).
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+template <typename T>
+struct Fields;											// specialized for every serializable class
+
+template <typename T, typename = void>
+struct is_described : false_type {};
+template <typename T>
+struct is_described<T, void_t<decltype(Fields<T>::list)>> : true_type {};
+
+// Bytes are the value : copy the object as a whole.
+template <typename T>
+constexpr bool is_flat_v = is_trivially_copyable<T>::value && has_unique_object_representations<T>::value;
+
+template <typename T>
+size_t encodedSize(const T& obj)
+{
+	if constexpr (is_flat_v<T> || is_arithmetic<T>::value)
+		return sizeof(T);
+	else if constexpr (is_same<T, string>::value)
+		return sizeof(uint32_t) + obj.size();
+	else
+		return apply([&](auto... member) { return (encodedSize(obj.*member) + ...); }, Fields<T>::list);
+}
+
+template <typename T>
+char* encode(char* out, const T& obj)
+{
+	if constexpr (is_flat_v<T> || is_arithmetic<T>::value)
+	{
+		memcpy(out, &obj, sizeof(T));
+		return out + sizeof(T);
+	}
+	else if constexpr (is_same<T, string>::value)
+	{
+		uint32_t len = static_cast<uint32_t>(obj.size());
+		memcpy(out, &len, sizeof(len));
+		memcpy(out + sizeof(len), obj.data(), len);
+		return out + sizeof(len) + len;
+	}
+	else
+	{
+		static_assert(is_described<T>::value, "list the members in Fields<T>");
+		apply([&](auto... member) { ((out = encode(out, obj.*member)), ...); }, Fields<T>::list);
+		return out;
+	}
+}
+
+template <typename T>
+const char* decode(const char* in, const char* end, T& obj)
+{
+	if constexpr (is_flat_v<T> || is_arithmetic<T>::value)
+	{
+		if(end - in < static_cast<ptrdiff_t>(sizeof(T)))
+			throw runtime_error("decode : truncated input");
+		memcpy(&obj, in, sizeof(T));
+		return in + sizeof(T);
+	}
+	else if constexpr (is_same<T, string>::value)
+	{
+		uint32_t len;
+		in = decode(in, end, len);
+		if(static_cast<size_t>(end - in) < len)
+			throw runtime_error("decode : truncated input");
+		obj.assign(in, len);
+		return in + len;
+	}
+	else
+	{
+		apply([&](auto... member) { ((in = decode(in, end, obj.*member)), ...); }, Fields<T>::list);
+		return in;
+	}
+}
+
+// A whole array into one contiguous buffer : [uint64 count][records...]
+template <typename T>
+vector<char> encodeAll(const vector<T>& objs)
+{
+	uint64_t count = objs.size();
+	size_t bytes = sizeof(count);
+	if constexpr (is_flat_v<T>)
+		bytes += objs.size() * sizeof(T);
+	else
+		for(const T& obj : objs)
+			bytes += encodedSize(obj);
+
+	vector<char> buf(bytes);
+	char* out = buf.data();
+	memcpy(out, &count, sizeof(count));
+	out += sizeof(count);
+	if constexpr (is_flat_v<T>)
+	{
+		if(!objs.empty())
+			memcpy(out, objs.data(), objs.size() * sizeof(T));		// the whole array at once
+	}
+	else
+		for(const T& obj : objs)
+			out = encode(out, obj);
+	return buf;
+}
+
+template <typename T>
+vector<T> decodeAll(const vector<char>& buf)
+{
+	const char* in = buf.data();
+	const char* end = in + buf.size();
+	uint64_t count;
+	in = decode(in, end, count);
+	if constexpr (is_flat_v<T>)
+	{
+		if(static_cast<size_t>(end - in) / sizeof(T) < count)
+			throw runtime_error("decodeAll : truncated input");
+		vector<T> objs(count);
+		if(count)
+			memcpy(objs.data(), in, count * sizeof(T));
+		return objs;
+	}
+	else
+	{
+		vector<T> objs;
+		objs.reserve(min<uint64_t>(count, static_cast<size_t>(end - in)));	// a corrupt count must not allocate gigabytes
+		for(uint64_t i = 0; i < count; ++i)
+		{
+			objs.emplace_back();
+			in = decode(in, end, objs.back());
+		}
+		return objs;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The lesson types, and the only thing each of them has to add : its member list.
+
+class collar
+{
+public:
+	int size = 0;
+	int color = 0;
+};
+
+class Dog2
+{
+public:
+	string m_name;
+	collar m_collar;
+};
+
+struct Person_t											// from 12_Struct_vs_Class.cpp
+{
+	string name;
+	unsigned int age;
+};
+
+class Rational											// from 15_Define_Implicit_Type_Conversion.cpp
+{
+public:
+	int num;
+	int den;
+};
+
+template <> struct Fields<collar>   { static constexpr auto list = make_tuple(&collar::size, &collar::color); };
+template <> struct Fields<Dog2>     { static constexpr auto list = make_tuple(&Dog2::m_name, &Dog2::m_collar); };
+template <> struct Fields<Person_t> { static constexpr auto list = make_tuple(&Person_t::name, &Person_t::age); };
+template <> struct Fields<Rational> { static constexpr auto list = make_tuple(&Rational::num, &Rational::den); };
+
+static_assert(is_flat_v<Rational> && is_flat_v<collar>, "single memcpy per object");
+static_assert(!is_flat_v<Dog2> && !is_flat_v<Person_t>, "walks the members");
+
+// The hand-written way, for comparison.
+ostream& operator<<(ostream& os, const Dog2& d) { return os<<d.m_name<<' '<<d.m_collar.size<<' '<<d.m_collar.color<<'\n'; }
+ostream& operator<<(ostream& os, const Person_t& p) { return os<<p.name<<' '<<p.age<<'\n'; }
+ostream& operator<<(ostream& os, const Rational& r) { return os<<r.num<<' '<<r.den<<'\n'; }
+istream& operator>>(istream& is, Dog2& d) { return is>>d.m_name>>d.m_collar.size>>d.m_collar.color; }
+istream& operator>>(istream& is, Person_t& p) { return is>>p.name>>p.age; }
+istream& operator>>(istream& is, Rational& r) { return is>>r.num>>r.den; }
+
+bool operator==(const Dog2& a, const Dog2& b) { return a.m_name == b.m_name && a.m_collar.size == b.m_collar.size && a.m_collar.color == b.m_collar.color; }
+bool operator==(const Person_t& a, const Person_t& b) { return a.name == b.name && a.age == b.age; }
+bool operator==(const Rational& a, const Rational& b) { return a.num == b.num && a.den == b.den; }
+
+template <typename T>
+void bench(const char* label, const vector<T>& objs)
+{
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	auto t0 = clk::now();
+	vector<char> buf = encodeAll(objs);
+	auto t1 = clk::now();
+	vector<T> back = decodeAll<T>(buf);
+	auto t2 = clk::now();
+
+	ostringstream os;
+	for(const T& obj : objs)
+		os<<obj;
+	string text = os.str();
+	auto t3 = clk::now();
+	istringstream is(text);
+	vector<T> back2(objs.size());
+	for(T& obj : back2)
+		is>>obj;
+	auto t4 = clk::now();
+
+	double mb = buf.size() / 1e6, tmb = text.size() / 1e6;
+	cout<<label<<" : binary "<<mb / ms(t0, t1) * 1e3<<" MB/s out, "<<mb / ms(t1, t2) * 1e3<<" MB/s in ("<<buf.size()<<" bytes)"
+		<<"  |  operator<< "<<tmb / ms(t2, t3) * 1e3<<" MB/s out, operator>> "<<tmb / ms(t3, t4) * 1e3<<" MB/s in ("
+		<<text.size()<<" bytes)"<<((back == objs && back2 == objs) ? "" : "  MISMATCH")<<endl;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+	const char* names[] = { "George", "Bob", "Henry", "Elizabeth", "Alexander_the_Great_of_Macedonia" };
+
+	vector<Dog2> dogs(N);
+	vector<Person_t> persons(N);
+	vector<Rational> rationals(N);
+	uint32_t seed = 1;
+	for(size_t i = 0; i < N; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		dogs[i] = Dog2{ names[i % 5], collar{ int(seed % 10), int(seed >> 24) } };
+		persons[i] = Person_t{ names[(i * 3) % 5], (seed >> 16) % 100 };
+		rationals[i] = Rational{ int(seed >> 1), int(seed % 1000) + 1 };
+	}
+
+	bench("Dog2    ", dogs);
+	bench("Person_t", persons);
+	bench("Rational", rationals);
+	return 0;
+}
+
+/*
+Output (g++ -O2, N = 2M, numbers vary by machine) :-
+
+	Dog2 and Person_t encode/decode at roughly 4-6x the speed of operator<< / operator>>, and Rational (one memcpy for
+	the whole array) runs at GB/s, 10-30x faster. The stream operators stay around 100 MB/s : every member goes through
+	number formatting/parsing and the stream's locale machinery.
+
+Note :-
+	1) Like the compiler generated copy constructor, this copies members, not what they point to : a raw pointer member
+	   would be written as an address. Give such a class its own encode()/decode() overloads instead of a Fields<> list.
+	2) Adding a member to a class without adding it to Fields<> silently leaves it out. Keep the list next to the class.
+*/
+
+
+
+/****************************************************** EXAMPLE 8 ******************************************************************/
+
+// Fixing Example 5 : Dog2 refers to its name through an 8 byte generational handle instead of string&.
+
+/*
+Example 5's "string& m_name" has two problems :-
+	1) It is bound to the constructor's by-value parameter, which dies when the constructor returns. m_name dangles.
+	2) A reference cannot be reseated, so the compiler cannot generate a real copy assignment operator (Case 1 at the
+	   top of this file). Without it, Dog2 cannot be sorted, put into a vector and erased from, etc.
+
+What Example 5 wanted was "many dogs refer to one name, without copying it". A handle gives that without the problems :-
+	- NameStore keeps the names in slots. A NameHandle is { slot index, generation } : two uint32_t, 8 bytes.
+	- Releasing a name bumps its slot's generation and puts the slot on a free list for reuse.
+	- get() checks the handle's generation against the slot's : O(1), and a handle to a released name is detected
+	  (throws) instead of silently reading whatever name reused the slot. That is the dangling reference, caught.
+	- The slots live in a deque, which never moves its elements when it grows : the string& returned by get() stays
+	  valid across later add()s, until that name is released.
+	- Dog2 only holds the handle, so all 4 compiler generated functions work again, and Dog2 is trivially copyable.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+using namespace std;
+
+struct NameHandle
+{
+	uint32_t index = 0;
+	uint32_t gen = 0;										// generation 0 is never valid : a default handle is "no name"
+};
+
+class NameStore
+{
+private:
+	struct Slot
+	{
+		string name;
+		uint32_t gen = 1;									// odd = in use, even = free
+		uint32_t nextFree = 0;
+	};
+
+	deque<Slot> m_slots;									// not vector : references to names must survive add()
+	uint32_t m_freeHead = UINT32_MAX;
+
+	NameStore() {}
+	NameStore(const NameStore&) = delete;
+	NameStore& operator=(const NameStore&) = delete;
+
+public:
+	static NameStore& instance()							// construct on first use, see 11_Static_Initialization_Fiasco.cpp
+	{
+		static NameStore* store = new NameStore;
+		return *store;
+	}
+
+	NameHandle add(string name)
+	{
+		uint32_t i;
+		if(m_freeHead != UINT32_MAX)
+		{
+			i = m_freeHead;
+			m_freeHead = m_slots[i].nextFree;
+			++m_slots[i].gen;								// even -> odd
+		}
+		else
+		{
+			if(m_slots.size() == UINT32_MAX)
+				throw length_error("NameStore : too many names");
+			i = static_cast<uint32_t>(m_slots.size());
+			m_slots.emplace_back();
+		}
+		m_slots[i].name = std::move(name);
+		return NameHandle{ i, m_slots[i].gen };
+	}
+
+	bool valid(NameHandle h) const
+	{
+		return h.index < m_slots.size() && m_slots[h.index].gen == h.gen && (h.gen & 1);
+	}
+
+	const string& get(NameHandle h) const					// valid until h's name is released
+	{
+		if(!valid(h))
+			throw out_of_range("NameStore : stale or invalid name handle");
+		return m_slots[h.index].name;
+	}
+
+	void release(NameHandle h)
+	{
+		if(!valid(h))
+			throw out_of_range("NameStore : stale or invalid name handle");
+		Slot& s = m_slots[h.index];
+		s.name = string();									// give the memory back now
+		++s.gen;											// odd -> even : every outstanding handle is now stale
+		if(s.gen == UINT32_MAX - 1)							// one more reuse would end in a wrap to 0 : retire the slot
+			return;
+		s.nextFree = m_freeHead;
+		m_freeHead = h.index;
+	}
+};
+
+class Dog2
+{
+public:
+	NameHandle m_name;
+
+	Dog2(NameHandle name = NameHandle()):m_name(name) {}
+
+	const string& name() const { return NameStore::instance().get(m_name); }
+};
+
+static_assert(sizeof(Dog2) == 8, "one handle");
+static_assert(is_trivially_copyable<Dog2>::value, "all 4 compiler generated functions are back, and trivial");
+
+class Dog2S													// Example 1's Dog2, for comparison
+{
+public:
+	string m_name;
+
+	Dog2S(string name = "Bob"):m_name(std::move(name)) {}
+
+	const string& name() const { return m_name; }
+};
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5000000;
+	const size_t NAMES = 1000;
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	NameStore& store = NameStore::instance();
+
+	{
+		NameHandle henry = store.add("Henry");
+		Dog2 d1(henry);
+		Dog2 d2 = d1;										// copy constructor
+		d2 = d1;											// copy assignment : works now
+		cout<<d1.name()<<" and "<<d2.name()<<endl;
+		store.release(henry);
+		NameHandle bob = store.add("Bob");					// reuses Henry's slot, with a new generation
+		try
+		{
+			cout<<d2.name()<<endl;
+		}
+		catch(const out_of_range& e)
+		{
+			cout<<"d2 : "<<e.what()<<" (and not \"Bob\")"<<endl;
+		}
+		store.release(bob);
+	}
+
+	vector<string> names;
+	vector<NameHandle> handles;
+	for(size_t i = 0; i < NAMES; ++i)
+	{
+		names.push_back("Alexander the Great of Macedonia, dog number " + to_string(i));
+		handles.push_back(store.add(names.back()));
+	}
+	cout<<"sizeof(Dog2) = "<<sizeof(Dog2)<<", sizeof(Dog2S) = "<<sizeof(Dog2S)<<endl;
+
+	auto t0 = clk::now();
+	vector<Dog2S> sdogs;
+	for(size_t i = 0; i < N; ++i)
+		sdogs.emplace_back(names[(i * 7919) % NAMES]);
+	auto t1 = clk::now();
+	vector<Dog2S> scopy = sdogs;
+	auto t2 = clk::now();
+	sort(scopy.begin(), scopy.end(), [](const Dog2S& a, const Dog2S& b) { return a.name() < b.name(); });
+	auto t3 = clk::now();
+	size_t ssum = 0;
+	for(const Dog2S& d : scopy)
+		ssum += d.name().size();
+	auto t4 = clk::now();
+	cout<<"vector<Dog2S> (string)  : build "<<ms(t0, t1)<<" ms, copy "<<ms(t1, t2)<<" ms, sort "<<ms(t2, t3)
+		<<" ms, read names "<<ms(t3, t4)<<" ms ("<<ssum<<")"<<endl;
+
+	t0 = clk::now();
+	vector<Dog2> hdogs;
+	for(size_t i = 0; i < N; ++i)
+		hdogs.emplace_back(handles[(i * 7919) % NAMES]);
+	t1 = clk::now();
+	vector<Dog2> hcopy = hdogs;
+	t2 = clk::now();
+	sort(hcopy.begin(), hcopy.end(), [](const Dog2& a, const Dog2& b) { return a.name() < b.name(); });
+	t3 = clk::now();
+	size_t hsum = 0;
+	for(const Dog2& d : hcopy)
+		hsum += d.name().size();
+	t4 = clk::now();
+	cout<<"vector<Dog2>  (handle)  : build "<<ms(t0, t1)<<" ms, copy "<<ms(t1, t2)<<" ms, sort "<<ms(t2, t3)
+		<<" ms, read names "<<ms(t3, t4)<<" ms ("<<hsum<<")"<<endl;
+
+	for(NameHandle h : handles)
+		store.release(h);
+	return 0;
+}
+
+/*
+Output (g++ -O2, N = 5M, 1000 distinct names, numbers vary by machine) :-
+
+Henry and Henry
+d2 : NameStore : stale or invalid name handle (and not "Bob")
+sizeof(Dog2) = 8, sizeof(Dog2S) = 32
+vector<Dog2S> (string)  : build 782.814 ms, copy 766.539 ms, sort 6546.08 ms, read names 25.7654 ms (239450000)
+vector<Dog2>  (handle)  : build 193.596 ms, copy 48.1981 ms, sort 4523.14 ms, read names 63.9397 ms (239450000)
+
+	Building and copying the handle-based vector is a plain 8-byte copy per dog (the copy is one memcpy), 4x and 15x
+	faster than copying a heap-allocated string per dog. Everything that reads the names is slower per access : each
+	name() is a generation check plus an indirection into the store, which is why reading all names takes 2.5x longer.
+	Sorting sits in between. It moves 8 byte handles instead of 32 byte strings, but each comparison pays for two of
+	those name() calls. Here that came out 1.4x faster, but on another machine the handle sort was slower (1312 ms
+	against 1121 ms), so do not count on a gain there.
+
+Note :-
+	1) Copies of a Dog2 share the name, just like Example 5 intended with string&. The name lives until someone
+	   releases it from the store; Dog2 does not own it, so Dog2's destructor does not release it.
+	2) NameStore is not thread-safe. Threads that add or release names concurrently need a mutex around the store.
+*/
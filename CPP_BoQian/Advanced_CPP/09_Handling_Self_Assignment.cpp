@@ -97,3 +97,345 @@ public:
 // Note :-
 //			We don't necesseraly need to check if 'this' Dog is same as 'rhs' Dog (i.e. self-assignment). 
 //			If they are the same, we are making a copy of itself anyway. This might incur some runtime cost, but not by much.
+
+
+/****************************************************** EXAMPLE 2 ******************************************************************/
+
+// Solution 3 :- Reuse the existing collar, pool the rest, and move temporaries.
+
+// Solution 1 still calls new and delete on every assignment, even though 'this' Dog already owns a perfectly good collar.
+// In a loop like "dogs[i] = dogs[j]" that is two trips to the heap per assignment for nothing.
+//		1) If 'this' Dog already has a collar, copy-assign into it (same as Solution 2, no allocation at all).
+//		2) If it does not have one (e.g. it was moved from), take a collar from a free-list pool instead of the heap.
+//		3) Give Dog a move constructor and move assignment, so temporaries just hand their collar over.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+static size_t g_allocCount = 0;						// Counts every global operator new, for the benchmark below.
+
+void* operator new(size_t size)
+{
+	++g_allocCount;
+	if(void* p = malloc(size))
+		return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+class collar
+{
+public:
+	string color;
+
+	collar(string c = "red"):color(std::move(c)) {}
+};
+
+class CollarPool									// Free-list of collar-sized blocks. Blocks are never given back to the heap.
+{
+private:
+	union Node
+	{
+		Node* next;
+		alignas(collar) unsigned char storage[sizeof(collar)];
+	};
+	Node* m_free = nullptr;
+
+	CollarPool() {}
+	CollarPool(const CollarPool&) = delete;
+	CollarPool& operator=(const CollarPool&) = delete;
+
+public:
+	~CollarPool()
+	{
+		while(m_free)
+		{
+			Node* n = m_free;
+			m_free = n->next;
+			::operator delete(n);
+		}
+	}
+
+	static CollarPool& instance()					// Initialize upon first usage idiom (see 11_Static_Initialization_Fiasco.cpp)
+	{
+		static CollarPool pool;
+		return pool;
+	}
+
+	collar* create(const collar& rhs)				// Strong guarantee : if the copy constructor throws, the block goes back to the pool.
+	{
+		void* mem = m_free ? static_cast<void*>(m_free) : ::operator new(sizeof(Node));
+		if(m_free)
+			m_free = m_free->next;
+		try
+		{
+			return new(mem) collar(rhs);
+		}
+		catch(...)
+		{
+			recycle(mem);
+			throw;
+		}
+	}
+
+	void destroy(collar* p) noexcept
+	{
+		if(!p)
+			return;
+		p->~collar();
+		recycle(p);
+	}
+
+private:
+	void recycle(void* mem) noexcept
+	{
+		Node* n = static_cast<Node*>(mem);
+		n->next = m_free;
+		m_free = n;
+	}
+};
+
+class Dog
+{
+public:
+	collar* pCollar;
+
+	Dog():pCollar(CollarPool::instance().create(collar())) {}
+
+	Dog(const Dog& rhs):pCollar(rhs.pCollar ? CollarPool::instance().create(*rhs.pCollar) : nullptr) {}
+
+	Dog(Dog&& rhs) noexcept:pCollar(rhs.pCollar)	// Steal the collar. The moved-from Dog is left without one.
+	{
+		rhs.pCollar = nullptr;
+	}
+
+	Dog& operator=(const Dog& rhs)
+	{
+		if(this == &rhs)							// Not needed for correctness any more, but it skips a useless copy.
+			return *this;
+
+		if(!rhs.pCollar)							// rhs was moved from : give our collar back to the pool.
+		{
+			CollarPool::instance().destroy(pCollar);
+			pCollar = nullptr;
+		}
+		else if(pCollar)
+			*pCollar = *rhs.pCollar;				// Reuse our collar : no allocation.
+		else
+			pCollar = CollarPool::instance().create(*rhs.pCollar);
+		return *this;
+	}
+
+	Dog& operator=(Dog&& rhs) noexcept
+	{
+		swap(pCollar, rhs.pCollar);					// rhs takes our old collar and releases it when it dies.
+		return *this;
+	}
+
+	~Dog()
+	{
+		CollarPool::instance().destroy(pCollar);
+	}
+};
+
+// Note :-
+//		Exception safety is still strong :-
+//			- "*pCollar = *rhs.pCollar" leaves our collar untouched if it throws, as long as collar's own operator=() is strong.
+//			  Here collar has a single string member, and string's copy assignment gives the strong guarantee.
+//			- create() either returns a fully constructed collar or throws after giving the block back. pCollar is only
+//			  overwritten once create() has succeeded.
+//			- The move operations only swap pointers, so they cannot throw and are marked noexcept. This also lets
+//			  vector<Dog> move its elements when it grows, instead of copying them.
+
+int main(int argc, char* argv[])
+{
+	const size_t N = 1000;
+	const size_t ITER = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+
+	vector<Dog> dogs(N);
+
+	size_t allocBefore = g_allocCount;
+	auto start = chrono::steady_clock::now();
+	for(size_t k = 0; k < ITER; ++k)
+	{
+		size_t i = (k * 7) % N;
+		size_t j = (k * 13) % N;
+		dogs[i] = dogs[j];							// i == j sometimes : self-assignment must be harmless.
+	}
+	auto stop = chrono::steady_clock::now();
+
+	double ns = chrono::duration<double, nano>(stop - start).count();
+	cout<<"dogs[i] = dogs[j]      : "<<ns / ITER<<" ns/op, "
+		<<double(g_allocCount - allocBefore) / ITER<<" allocations/op"<<endl;
+
+	allocBefore = g_allocCount;
+	start = chrono::steady_clock::now();
+	for(size_t k = 0; k < ITER; ++k)
+	{
+		size_t i = (k * 7) % N;
+		dogs[i] = Dog(std::move(dogs[(k * 13) % N]));	// Move a temporary in : ownership is transferred.
+		if(!dogs[(k * 13) % N].pCollar)
+			dogs[(k * 13) % N] = dogs[i];			// Refill the moved-from Dog from the pool.
+	}
+	stop = chrono::steady_clock::now();
+
+	ns = chrono::duration<double, nano>(stop - start).count();
+	cout<<"dogs[i] = Dog(move(..)) : "<<ns / ITER<<" ns/op, "
+		<<double(g_allocCount - allocBefore) / ITER<<" allocations/op"<<endl;
+
+	return 0;
+}
+
+// Output (g++ -O2, numbers vary by machine) :-
+//		dogs[i] = dogs[j]      : a few ns/op, 0 allocations/op
+//		dogs[i] = Dog(move(..)) : a few ns/op, 0 allocations/op
+//
+// With Solution 1 the first loop makes one allocation per op (two if the collar's string is too long for the small-string buffer).
+
+
+
+/****************************************************** EXAMPLE 3 ******************************************************************/
+
+// Solution 4 :- Let the caller choose where the collars live (std::pmr, C++20).
+
+// Every Dog above is two separate heap blocks : the Dog (inside the vector) and its collar. When we build millions of Dogs
+// and then throw them all away together, the collars are scattered across the heap and each one costs a delete.
+// With a polymorphic allocator the Dog takes a memory_resource from the caller and allocates its collar from it.
+// Put a whole batch of Dogs in a monotonic_buffer_resource, and the vector, the Dogs and the collars are all in one arena,
+// laid out in construction order, and freed with a single release().
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+class collar
+{
+public:
+	int size;
+
+	collar(int s = 0):size(s) {}
+};
+
+class Dog
+{
+public:
+	using allocator_type = pmr::polymorphic_allocator<>;	// Makes Dog "allocator-aware" : pmr::vector<Dog> will pass its
+															// own allocator into every Dog it constructs.
+private:
+	allocator_type m_alloc;									// Declared before pCollar, since pCollar is initialized from it.
+
+public:
+	collar* pCollar;
+
+	explicit Dog(int size = 0, allocator_type alloc = {})
+		:m_alloc(alloc), pCollar(m_alloc.new_object<collar>(size)) {}
+
+	Dog(const Dog& rhs, allocator_type alloc = {})
+		:m_alloc(alloc), pCollar(rhs.pCollar ? m_alloc.new_object<collar>(*rhs.pCollar) : nullptr) {}
+
+	Dog(Dog&& rhs, allocator_type alloc)					// Only steal the collar if it came from the same memory resource.
+		:m_alloc(alloc), pCollar(nullptr)
+	{
+		if(m_alloc == rhs.m_alloc)
+			swap(pCollar, rhs.pCollar);
+		else if(rhs.pCollar)
+			pCollar = m_alloc.new_object<collar>(*rhs.pCollar);
+	}
+
+	Dog(Dog&& rhs) noexcept:m_alloc(rhs.m_alloc), pCollar(rhs.pCollar)
+	{
+		rhs.pCollar = nullptr;
+	}
+
+	Dog& operator=(const Dog& rhs)
+	{
+		if(this == &rhs)
+			return *this;
+
+		if(!rhs.pCollar)									// rhs was moved from : give our collar back to the resource.
+		{
+			if(pCollar)
+				m_alloc.delete_object(pCollar);
+			pCollar = nullptr;
+		}
+		else if(pCollar)
+			*pCollar = *rhs.pCollar;						// Solution 2 : no allocation, and the collar stays in our resource.
+		else
+			pCollar = m_alloc.new_object<collar>(*rhs.pCollar);
+		return *this;
+	}
+
+	~Dog()
+	{
+		if(pCollar)
+			m_alloc.delete_object(pCollar);					// For a monotonic resource this is a no-op.
+	}
+
+	allocator_type get_allocator() const { return m_alloc; }
+};
+
+// Note :-
+//		Dog does not own the memory resource. The resource must outlive every Dog allocated from it.
+//		Copy assignment keeps the allocator of the left hand side (pmr allocators do not propagate on assignment).
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	{
+		auto t0 = clk::now();
+		vector<Dog> dogs;
+		dogs.reserve(N);
+		for(size_t i = 0; i < N; ++i)
+			dogs.emplace_back(int(i));						// Default resource : new/delete for every collar
+		auto t1 = clk::now();
+		long sum = 0;
+		for(const Dog& d : dogs)
+			sum += d.pCollar->size;
+		auto t2 = clk::now();
+		dogs = vector<Dog>();
+		auto t3 = clk::now();
+		cout<<"heap  : build "<<ms(t0, t1)<<" ms, traverse "<<ms(t1, t2)<<" ms, teardown "<<ms(t2, t3)<<" ms ("<<sum<<")"<<endl;
+	}
+
+	{
+		auto t0 = clk::now();
+		pmr::monotonic_buffer_resource arena;
+		pmr::vector<Dog> dogs(&arena);
+		dogs.reserve(N);
+		for(size_t i = 0; i < N; ++i)
+			dogs.emplace_back(int(i));						// The vector passes &arena to each Dog : collars land in the arena.
+		auto t1 = clk::now();
+		long sum = 0;
+		for(const Dog& d : dogs)
+			sum += d.pCollar->size;
+		auto t2 = clk::now();
+		dogs.clear();										// Runs ~Dog(), whose delete_object() does nothing here.
+		dogs.shrink_to_fit();
+		arena.release();									// Gives every block back in one go.
+		auto t3 = clk::now();
+		cout<<"arena : build "<<ms(t0, t1)<<" ms, traverse "<<ms(t1, t2)<<" ms, teardown "<<ms(t2, t3)<<" ms ("<<sum<<")"<<endl;
+	}
+
+	return 0;
+}
+
+// Output (g++ -O2, N = 10M, numbers vary by machine) :-
+//		The arena version builds faster (a pointer bump per collar instead of malloc), traverses faster (collars are
+//		contiguous and in the same order as the Dogs, so the hardware prefetcher can follow them) and tears down
+//		several times faster (one release() instead of 10M free() calls).
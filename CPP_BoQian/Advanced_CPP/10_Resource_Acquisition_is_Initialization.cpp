@@ -98,3 +98,567 @@ void functionA()
 // INCOMPLETE
 // ============================================
 
+
+
+/****************************************************** EXAMPLE 3 ******************************************************************/
+
+// A real Mutex_t for the Lock of Example 1 : on Linux, spin briefly with exponential backoff, then sleep on a futex.
+
+/*
+Example 1 leaves Mutex_t, Mutex_lock() and Mutex_unlock() abstract. Here is a concrete one. It is built for short
+critical sections (a few hundred ns), where going to sleep in the kernel on every contended lock costs far more than
+the critical section itself.
+
+The state is one 32 bit atomic :  0 = unlocked,  1 = locked,  2 = locked and somebody may be sleeping on it.
+	Mutex_lock()		one compare-exchange 0 -> 1. That is all when the mutex is free.
+						Otherwise it spins : it waits 1, 2, 4 ... 1024 pause instructions (exponential backoff, so that
+						spinning threads do not hammer the cache line) and retries, for a few microseconds in total. If
+						that fails it sets the state to 2 and sleeps in futex(FUTEX_WAIT) until it can take the mutex.
+	Mutex_unlock()		one exchange -> 0. Only if the old state was 2 does it make a system call (FUTEX_WAKE, one thread).
+So an uncontended lock/unlock is two atomic instructions and no system call, a briefly contended one is a short spin
+instead of two context switches, and a long wait still sleeps instead of burning a core. On a single core machine
+spinning cannot help (the owner cannot run while we spin), so there it goes straight to the futex.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+struct Mutex_t
+{
+	atomic<uint32_t> state;										// 0 unlocked, 1 locked, 2 locked with (possible) sleepers
+};
+
+#define MUTEX_INITIALIZER {}
+
+static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t) && atomic<uint32_t>::is_always_lock_free, "the futex word is the atomic itself");
+
+inline void cpuRelax()											// tells the CPU this is a spin loop (saves power, frees the sibling hyperthread)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield");
+#endif
+}
+
+inline void futexWait(atomic<uint32_t>* word, uint32_t expected)	// sleeps only if *word is still expected
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+inline void futexWakeOne(atomic<uint32_t>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void Mutex_lock_contended(Mutex_t* pm)
+{
+	static const uint32_t maxBackoff = thread::hardware_concurrency() > 1 ? 1024 : 0;
+	for(uint32_t backoff = 1; backoff <= maxBackoff; backoff *= 2)
+	{
+		for(uint32_t i = 0; i < backoff; ++i)
+			cpuRelax();
+		uint32_t expected = 0;									// read first : a failing compare-exchange still takes the line exclusive
+		if(pm->state.load(memory_order_relaxed) == 0 && pm->state.compare_exchange_weak(expected, 1, memory_order_acquire, memory_order_relaxed))
+			return;
+	}
+	// Park. Whoever holds the mutex now sees 2 and will wake us. We take it with 2 as well, since we cannot know
+	// whether others are still sleeping : at worst that costs one unnecessary FUTEX_WAKE.
+	while(pm->state.exchange(2, memory_order_acquire) != 0)
+		futexWait(&pm->state, 2);
+}
+
+inline void Mutex_lock(Mutex_t* pm)
+{
+	uint32_t expected = 0;
+	if(!pm->state.compare_exchange_strong(expected, 1, memory_order_acquire, memory_order_relaxed))
+		Mutex_lock_contended(pm);
+}
+
+inline void Mutex_unlock(Mutex_t* pm)
+{
+	if(pm->state.exchange(0, memory_order_release) == 2)
+		futexWakeOne(&pm->state);
+}
+
+class Lock
+{
+private:
+	Mutex_t *m_pm;							// Pointer to mutex
+public:
+	explicit Lock(Mutex_t *pm)
+	{
+		Mutex_lock(pm);						// In the constructor of the Lock class, the mutex will be locked.
+		m_pm = pm;
+	}
+
+	~Lock()
+	{
+		Mutex_unlock(m_pm);					// In the destructor of the Lock, the mutex will be unlocked.
+	}
+
+	Lock(const Lock&) = delete;				// See the Note of Example 1
+	Lock& operator=(const Lock&) = delete;
+};
+
+Mutex_t mu = MUTEX_INITIALIZER;
+std::mutex stdMu;
+uint64_t sharedCounter = 0;									// the state the mutexes protect
+
+inline void burn(uint32_t iterations)							// "do a bunch of stuff" : a loop the compiler cannot remove
+{
+	for(uint32_t i = 0; i < iterations; ++i)
+		asm volatile("");
+}
+
+void functionA(uint32_t work)
+{
+	Lock myLock(&mu);
+	++sharedCounter;
+	burn(work);
+}
+
+void functionA_std(uint32_t work)
+{
+	lock_guard<std::mutex> myLock(stdMu);
+	++sharedCounter;
+	burn(work);
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;	// lock/unlock per test, over all threads
+	using clk = chrono::steady_clock;
+	auto ns = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, nano>(b - a).count(); };
+
+	auto t0 = clk::now();										// how many burn() iterations per ns
+	burn(100000000);
+	const double itersPerNs = 1e8 / ns(t0, clk::now());
+
+	// Uncontended : the cost of the lock itself. (Once a second thread has existed. Until then glibc knows the
+	// process is single threaded and lets std::mutex skip the atomic instructions.)
+	thread([]() {}).join();
+	t0 = clk::now();
+	for(size_t i = 0; i < N; ++i)
+		functionA(0);
+	auto t1 = clk::now();
+	for(size_t i = 0; i < N; ++i)
+		functionA_std(0);
+	auto t2 = clk::now();
+	cout<<"uncontended lock + unlock : Mutex_t "<<ns(t0, t1) / N<<" ns, std::mutex "<<ns(t1, t2) / N<<" ns"<<endl;
+
+	// Contended : T threads, each doing its share of N calls, with 'cs' ns inside and as much again outside the lock.
+	cout<<"hardware threads : "<<thread::hardware_concurrency()<<endl;
+	for(unsigned cs : { 0u, 100u, 400u })
+		for(unsigned T : { 2u, 4u, 8u })
+		{
+			const uint32_t work = static_cast<uint32_t>(cs * itersPerNs);
+			auto contend = [&](auto fn)
+			{
+				sharedCounter = 0;
+				vector<thread> threads;
+				auto start = clk::now();
+				for(unsigned t = 0; t < T; ++t)
+					threads.emplace_back([&, t]()
+					{
+						for(size_t i = t; i < N; i += T)
+						{
+							fn(work);
+							burn(work);
+						}
+					});
+				for(thread& th : threads)
+					th.join();
+				double total = ns(start, clk::now());
+				return sharedCounter == N ? total / N : -1.0;	// -1 : lost updates, i.e. the mutex is broken
+			};
+			double a = contend(functionA), b = contend(functionA_std);
+			cout<<"critical section "<<cs<<" ns, "<<T<<" threads : Mutex_t "<<a<<" ns/op, std::mutex "<<b<<" ns/op"<<endl;
+		}
+	return 0;
+}
+
+/*
+Output (g++ -O2, N = 2M, numbers vary by machine) :-
+
+uncontended lock + unlock : Mutex_t 17.0345 ns, std::mutex 21.2901 ns
+hardware threads : 1
+critical section 0 ns, 2 threads : Mutex_t 18.9168 ns/op, std::mutex 19.0786 ns/op
+critical section 0 ns, 4 threads : Mutex_t 18.8214 ns/op, std::mutex 18.6717 ns/op
+critical section 0 ns, 8 threads : Mutex_t 19.0535 ns/op, std::mutex 19.2323 ns/op
+critical section 100 ns, 2 threads : Mutex_t 244.079 ns/op, std::mutex 247.623 ns/op
+critical section 100 ns, 4 threads : Mutex_t 244.045 ns/op, std::mutex 315.264 ns/op
+critical section 100 ns, 8 threads : Mutex_t 326.046 ns/op, std::mutex 355.66 ns/op
+critical section 400 ns, 2 threads : Mutex_t 867.719 ns/op, std::mutex 1223.11 ns/op
+critical section 400 ns, 4 threads : Mutex_t 1226.91 ns/op, std::mutex 1223.79 ns/op
+critical section 400 ns, 8 threads : Mutex_t 1127.71 ns/op, std::mutex 915.053 ns/op
+
+	Uncontended, Mutex_t is a little cheaper than std::mutex (pthread_mutex_lock checks the mutex type first).
+	These numbers come from a single core machine, where Mutex_t never spins and both mutexes end up sleeping on a
+	futex whenever a thread is preempted inside the critical section. So they only differ by noise. With several cores
+	and short critical sections, the spin phase is where Mutex_t wins : a waiter usually gets the mutex within a few
+	hundred ns, without the two context switches of a FUTEX_WAIT / FUTEX_WAKE pair.
+
+Note :-
+	1) Mutex_t is not fair : a thread that just unlocked can take the mutex again before the woken one runs. That is
+	   what makes it fast, and what std::mutex (also unfair on Linux) does as well.
+	2) The futex system call is Linux only. On other systems the same scheme works with their wait-on-address call
+	   (WaitOnAddress on Windows), or in portable C++20 with atomic<uint32_t>::wait() / notify_one().
+*/
+
+
+
+/****************************************************** EXAMPLE 4 ******************************************************************/
+
+// SharedLock / ExclusiveLock : RAII for a reader-writer mutex whose readers never write a shared cache line.
+
+/*
+Lock (Examples 1 and 3) lets one thread at a time into functionA(). If most callers only read the protected state,
+they could all be inside at once : that is a reader-writer mutex, with two RAII classes :
+	SharedLock		for readers. Any number of them at a time.
+	ExclusiveLock	for writers. One at a time, and no readers.
+
+A plain reader-writer mutex (std::shared_mutex, pthread_rwlock_t) counts its readers in one shared variable, so every
+reader, even with no writer anywhere, does an atomic increment and decrement on the same cache line. With many cores
+that line moves from core to core on every lock, and readers slow each other down although they never wait for each
+other.
+
+RWMutex_t gives every core its own reader counter, on its own cache line (the reader indicator). A reader increments
+the counter of the core it runs on (sched_getcpu()), then reads the writer flag : if there is no writer, it is in. It
+never writes a line that another core writes, and the writer flag, only read, stays cached on every core.
+A writer serializes with other writers (a Mutex_t of Example 3), raises the writer flag, and waits until the counters
+of all cores are zero. Both sides use sequentially consistent atomics, so either the reader sees the flag, or the writer
+sees the reader's count.
+	WRITER_PREFERENCE	once a writer is waiting, new readers wait too (they undo their increment and sleep on the
+						flag). A steady stream of readers cannot starve the writer.
+	READER_PREFERENCE	new readers keep coming in until the writer has actually got the mutex. Best read throughput,
+						but a writer can wait as long as readers overlap.
+The price is size (64 cache lines per mutex) and a writer that must look at every counter.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Mutex_t, Mutex_lock() and Mutex_unlock() of Example 3 (spin, then futex), for the writers.
+struct Mutex_t
+{
+	atomic<uint32_t> state;
+};
+
+#define MUTEX_INITIALIZER {}
+
+inline void futexWait(atomic<uint32_t>* word, uint32_t expected)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+inline void futexWakeOne(atomic<uint32_t>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+inline void futexWakeAll(atomic<uint32_t>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+void Mutex_lock(Mutex_t* pm)									// (the spinning of Example 3 left out for brevity)
+{
+	uint32_t expected = 0;
+	if(pm->state.compare_exchange_strong(expected, 1, memory_order_acquire, memory_order_relaxed))
+		return;
+	while(pm->state.exchange(2, memory_order_acquire) != 0)
+		futexWait(&pm->state, 2);
+}
+
+void Mutex_unlock(Mutex_t* pm)
+{
+	if(pm->state.exchange(0, memory_order_release) == 2)
+		futexWakeOne(&pm->state);
+}
+
+class RWMutex_t
+{
+public:
+	enum Preference { WRITER_PREFERENCE, READER_PREFERENCE };
+
+private:
+	static constexpr size_t SLOTS = 64;							// reader indicators : cores beyond 64 share them
+
+	enum WriterState : uint32_t { NONE, WAITING, ACTIVE };
+
+	struct alignas(64) Slot
+	{
+		atomic<int32_t> readers{ 0 };
+	};
+
+	Slot m_slots[SLOTS];
+	alignas(64) atomic<uint32_t> m_writer{ NONE };				// read by every reader, written only by writers
+	atomic<uint32_t> m_sleepers{ 0 };							// readers sleeping on m_writer
+	Mutex_t m_writerMutex = MUTEX_INITIALIZER;
+	const Preference m_preference;
+
+	bool blocksReaders(uint32_t writer) const
+	{
+		return writer == ACTIVE || (writer == WAITING && m_preference == WRITER_PREFERENCE);
+	}
+
+	bool noReaders() const
+	{
+		for(const Slot& s : m_slots)
+			if(s.readers.load() != 0)
+				return false;
+		return true;
+	}
+
+public:
+	explicit RWMutex_t(Preference preference = WRITER_PREFERENCE):m_preference(preference) {}
+
+	RWMutex_t(const RWMutex_t&) = delete;
+	RWMutex_t& operator=(const RWMutex_t&) = delete;
+
+	// Returns the slot that unlock_shared() must decrement (the thread may be on another core by then).
+	size_t lock_shared()
+	{
+		const int cpu = sched_getcpu();
+		Slot& s = m_slots[static_cast<size_t>(cpu < 0 ? 0 : cpu) % SLOTS];
+		for(;;)
+		{
+			s.readers.fetch_add(1);
+			uint32_t writer = m_writer.load();
+			if(!blocksReaders(writer))
+				return &s - m_slots;
+			s.readers.fetch_sub(1);								// back off, so that the writer can finish
+			m_sleepers.fetch_add(1);
+			while(blocksReaders(writer = m_writer.load()))
+				futexWait(&m_writer, writer);
+			m_sleepers.fetch_sub(1);
+		}
+	}
+
+	void unlock_shared(size_t slot) { m_slots[slot].readers.fetch_sub(1, memory_order_release); }
+
+	void lock()
+	{
+		Mutex_lock(&m_writerMutex);
+		m_writer.store(WAITING);
+		for(;;)
+		{
+			while(!noReaders())									// readers do not notify : wait politely
+				this_thread::yield();
+			m_writer.store(ACTIVE);
+			if(noReaders())										// a reader that saw WAITING (READER_PREFERENCE) is counted by now
+				return;
+			m_writer.store(WAITING);
+			if(m_sleepers.load() != 0)							// READER_PREFERENCE readers that slept on ACTIVE may go in again
+				futexWakeAll(&m_writer);
+		}
+	}
+
+	void unlock()
+	{
+		m_writer.store(NONE);
+		if(m_sleepers.load() != 0)
+			futexWakeAll(&m_writer);
+		Mutex_unlock(&m_writerMutex);
+	}
+};
+
+class SharedLock
+{
+private:
+	RWMutex_t *m_pm;
+	size_t m_slot;
+public:
+	explicit SharedLock(RWMutex_t *pm):m_pm(pm), m_slot(pm->lock_shared()) {}
+	~SharedLock() { m_pm->unlock_shared(m_slot); }
+
+	SharedLock(const SharedLock&) = delete;
+	SharedLock& operator=(const SharedLock&) = delete;
+};
+
+class ExclusiveLock
+{
+private:
+	RWMutex_t *m_pm;
+public:
+	explicit ExclusiveLock(RWMutex_t *pm):m_pm(pm) { pm->lock(); }
+	~ExclusiveLock() { m_pm->unlock(); }
+
+	ExclusiveLock(const ExclusiveLock&) = delete;
+	ExclusiveLock& operator=(const ExclusiveLock&) = delete;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The protected state : 8 counters that writers increment together. A reader that sees them differ has raced a writer.
+
+struct State
+{
+	uint64_t v[8] = {};
+};
+
+State g_state;
+atomic<uint64_t> g_torn{ 0 };
+atomic<uint64_t> g_sink{ 0 };								// keeps the reads from being optimized away
+
+inline uint64_t readState()
+{
+	uint64_t sum = 0;
+	for(uint64_t x : g_state.v)
+		sum += x;
+	if(sum != 8 * g_state.v[0])
+		g_torn.fetch_add(1, memory_order_relaxed);
+	return sum;
+}
+
+inline void writeState()
+{
+	for(uint64_t& x : g_state.v)
+		++x;
+}
+
+// The locks compared, behind one interface : read(body) / write(body).
+struct Rw
+{
+	const char* name;
+	RWMutex_t* rw;
+	std::shared_mutex* srw;
+
+	template <typename F>
+	void read(F f) const
+	{
+		if(rw) { SharedLock l(rw); f(); }
+		else { shared_lock<std::shared_mutex> l(*srw); f(); }
+	}
+
+	template <typename F>
+	void write(F f) const
+	{
+		if(rw) { ExclusiveLock l(rw); f(); }
+		else { unique_lock<std::shared_mutex> l(*srw); f(); }
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4000000;	// operations per test, over all threads
+	using clk = chrono::steady_clock;
+	auto ns = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, nano>(b - a).count(); };
+
+	RWMutex_t writerPref(RWMutex_t::WRITER_PREFERENCE), readerPref(RWMutex_t::READER_PREFERENCE);
+	std::shared_mutex stdRw;
+
+	const Rw locks[] = { { "RWMutex_t, writer pref.", &writerPref, nullptr }, { "RWMutex_t, reader pref.", &readerPref, nullptr },
+						 { "std::shared_mutex      ", nullptr, &stdRw } };
+
+	// T threads share N operations; one in 'writeEvery' is a write. Returns ns per operation, and the writers' latency.
+	auto run = [&](const Rw& lock, unsigned T, size_t writeEvery, double& p50, double& p99)
+	{
+		vector<vector<double>> latencies(T);
+		vector<thread> threads;
+		auto start = clk::now();
+		for(unsigned t = 0; t < T; ++t)
+			threads.emplace_back([&, t]()
+			{
+				uint64_t sink = 0;
+				for(size_t i = t; i < N; i += T)
+					if(writeEvery && i % writeEvery == 0)
+					{
+						auto w0 = clk::now();
+						lock.write([&]() { latencies[t].push_back(ns(w0, clk::now())); writeState(); });
+					}
+					else
+						lock.read([&]() { sink += readState(); });
+				g_sink.fetch_add(sink);
+			});
+		for(thread& th : threads)
+			th.join();
+		const double perOp = ns(start, clk::now()) / N;
+		vector<double> all;
+		for(const vector<double>& l : latencies)
+			all.insert(all.end(), l.begin(), l.end());
+		sort(all.begin(), all.end());
+		p50 = all.empty() ? 0 : all[all.size() / 2];
+		p99 = all.empty() ? 0 : all[all.size() * 99 / 100];
+		return perOp;
+	};
+
+	cout<<"hardware threads : "<<thread::hardware_concurrency()<<endl;
+	double p50, p99;
+	for(const Rw& lock : locks)
+	{
+		cout<<lock.name<<" | reads only, M reads/s : ";
+		for(unsigned T : { 1u, 2u, 4u, 8u })
+			cout<<T<<" thr "<<1e3 / run(lock, T, 0, p50, p99)<<"  ";
+		cout<<endl;
+	}
+	for(size_t writeEvery : { 100u, 10u })
+		for(const Rw& lock : locks)
+		{
+			double perOp = run(lock, 4, writeEvery, p50, p99);
+			cout<<lock.name<<" | "<<100 - 100 / writeEvery<<"/"<<100 / writeEvery<<" reads/writes, 4 threads : "<<1e3 / perOp
+				<<" M ops/s, writer waits p50 "<<p50<<" ns, p99 "<<p99<<" ns"<<endl;
+		}
+	cout<<"torn reads : "<<g_torn.load()<<endl;
+	return 0;
+}
+
+/*
+Output (g++ -O2, N = 4M, numbers vary by machine) :-
+
+hardware threads : 1
+RWMutex_t, writer pref. | reads only, M reads/s : 1 thr 38.9361  2 thr 38.6161  4 thr 38.5983  8 thr 36.7504
+RWMutex_t, reader pref. | reads only, M reads/s : 1 thr 37.6785  2 thr 39.235  4 thr 38.8924  8 thr 37.7114
+std::shared_mutex       | reads only, M reads/s : 1 thr 33.4807  2 thr 36.3554  4 thr 36.5983  8 thr 36.9527
+RWMutex_t, writer pref. | 99/1 reads/writes, 4 threads : 33.3703 M ops/s, writer waits p50 148 ns, p99 168 ns
+RWMutex_t, reader pref. | 99/1 reads/writes, 4 threads : 35.0042 M ops/s, writer waits p50 147 ns, p99 168 ns
+std::shared_mutex       | 99/1 reads/writes, 4 threads : 34.3884 M ops/s, writer waits p50 76 ns, p99 91 ns
+RWMutex_t, writer pref. | 90/10 reads/writes, 4 threads : 21.7338 M ops/s, writer waits p50 146 ns, p99 163 ns
+RWMutex_t, reader pref. | 90/10 reads/writes, 4 threads : 20.6717 M ops/s, writer waits p50 152 ns, p99 163 ns
+std::shared_mutex       | 90/10 reads/writes, 4 threads : 23.0735 M ops/s, writer waits p50 76 ns, p99 90 ns
+torn reads : 0
+
+	Measured on a single core machine, so this shows the costs, not the scaling : the threads take turns, and no two
+	cores ever fight over a cache line. A read costs about the same with both mutexes (one atomic increment and one
+	decrement either way). A write costs RWMutex_t about 150 ns, because it scans all 64 reader indicators twice, which
+	is twice what std::shared_mutex needs.
+	With many cores the read column is where they differ : std::shared_mutex readers all increment the same counter,
+	so reads/s stop growing (or drop) as threads are added, while RWMutex_t readers each touch only their own core's
+	line and scale with the number of cores.
+
+Note :-
+	1) A reader-writer mutex only pays off when reads are frequent and writes rare. At 90/10 the writers' scans, and
+	   the readers they hold back, already cost more than RWMutex_t saves.
+	2) Writer preference matters only when readers overlap all the time. Then, with READER_PREFERENCE, a writer may wait
+	   indefinitely, and with WRITER_PREFERENCE it waits only for the readers already inside.
+*/
@@ -147,3 +147,318 @@ int main()
 	Singleton::getCat->meow();
 	return 0;
 }
+
+
+
+/****************************************************** EXAMPLE 2 ******************************************************************/
+
+// A pool of interned names shared by Cat, Dog and Person, built with the same "initialize upon first usage" idiom.
+
+// Cat, Dog (15_Define_Implicit_Type_Conversion.cpp) and Person (13_Resource_Managing_Class.cpp) each keep their own copy
+// of their name. With millions of objects and only thousands of distinct names, almost all of those copies are duplicates.
+// Instead, every distinct name is stored once in a NamePool, and each object only keeps a 4-byte Name handle :-
+//		- Two Names are equal if and only if their handles are equal : O(1), no string compare.
+//		- Name::view() returns a string_view that stays valid until the program ends (the pool never moves or frees a name).
+//		- The pool is safe to use from many threads at once.
+//
+// The pool is a global object used from other global objects' constructors (Cat c("Smokey") above), so it has exactly
+// the static initialization fiasco problem. Like Singleton::getDog(), NamePool::instance() creates it on first use.
+
+// ----------------------
+// File :- NamePool.h
+// ----------------------
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+class NamePool
+{
+private:
+	// The pool is split into 16 shards, chosen by the name's hash, so threads interning different names rarely share a lock.
+	// A handle is (shard << 28) | index. Entries are stored in fixed-size chunks that never move, and the chunk table is
+	// preallocated, so reading a name back from a handle takes no lock at all.
+	static const unsigned SHARD_BITS = 4;
+	static const unsigned SHARDS = 1u << SHARD_BITS;
+	static const unsigned INDEX_BITS = 32 - SHARD_BITS;
+	static const size_t MAX_PER_SHARD = size_t(1) << 24;					// 16M names per shard, 256M in total
+	static const size_t CHUNK_SIZE = 1024;									// entries per chunk
+	static const size_t MAX_CHUNKS = MAX_PER_SHARD / CHUNK_SIZE;
+	static const size_t CHAR_BLOCK = 64 * 1024;								// characters are copied into 64KB blocks
+
+	struct Entry
+	{
+		const char* ptr;
+		uint32_t len;
+	};
+
+	struct Shard
+	{
+		shared_mutex mu;
+		unordered_map<string_view, uint32_t> index;							// keys point into 'blocks', so they never dangle
+		atomic<Entry*> chunks[MAX_CHUNKS] = {};
+		uint32_t count = 0;
+		vector<unique_ptr<char[]>> blocks;
+		vector<unique_ptr<char[]>> hugeBlocks;								// kept apart, so that blocks.back() is always the current block
+		size_t hugeBytes = 0;
+		size_t blockUsed = CHAR_BLOCK;
+
+		~Shard()
+		{
+			for(auto& c : chunks)
+				delete[] c.load(memory_order_relaxed);
+		}
+
+		const char* store(string_view s)									// Copy the characters into the current block
+		{
+			if(s.empty())													// Nothing to copy, and maybe no block yet
+				return "";
+			if(s.size() > CHAR_BLOCK)										// Huge name : gets a block of its own
+			{
+				hugeBlocks.emplace_back(new char[s.size()]);
+				hugeBytes += s.size();
+				memcpy(hugeBlocks.back().get(), s.data(), s.size());
+				return hugeBlocks.back().get();
+			}
+			if(blockUsed + s.size() > CHAR_BLOCK)
+			{
+				blocks.emplace_back(new char[CHAR_BLOCK]);
+				blockUsed = 0;
+			}
+			char* dst = blocks.back().get() + blockUsed;
+			memcpy(dst, s.data(), s.size());
+			blockUsed += s.size();
+			return dst;
+		}
+	};
+
+	Shard m_shards[SHARDS];
+
+	NamePool() {}
+	NamePool(const NamePool&) = delete;
+	NamePool& operator=(const NamePool&) = delete;
+
+public:
+	static NamePool& instance()						// Initialize upon first usage. Since C++11 this is also thread-safe.
+	{
+		static NamePool* pool = new NamePool;		// Never destroyed on purpose : names must stay valid while other
+		return *pool;								// global objects are being destroyed (the same fiasco, at exit).
+	}
+
+	uint32_t intern(string_view s)
+	{
+		size_t h = hash<string_view>()(s);
+		unsigned shardNo = static_cast<unsigned>(h >> (sizeof(size_t) * 8 - SHARD_BITS));
+		Shard& sh = m_shards[shardNo];
+
+		{
+			shared_lock<shared_mutex> lock(sh.mu);	// Common case : the name is already there. Readers don't block each other.
+			auto it = sh.index.find(s);
+			if(it != sh.index.end())
+				return it->second;
+		}
+
+		unique_lock<shared_mutex> lock(sh.mu);
+		auto it = sh.index.find(s);					// Someone may have inserted it between the two locks.
+		if(it != sh.index.end())
+			return it->second;
+
+		uint32_t idx = sh.count;
+		if(idx >= MAX_PER_SHARD)
+			throw length_error("NamePool shard is full");
+		size_t chunkNo = idx / CHUNK_SIZE;
+		Entry* chunk = sh.chunks[chunkNo].load(memory_order_relaxed);
+		if(!chunk)
+		{
+			chunk = new Entry[CHUNK_SIZE];
+			sh.chunks[chunkNo].store(chunk, memory_order_release);
+		}
+		const char* p = sh.store(s);
+		chunk[idx % CHUNK_SIZE] = Entry{ p, static_cast<uint32_t>(s.size()) };
+		sh.index.emplace(string_view(p, s.size()), (shardNo << INDEX_BITS) | idx);
+		++sh.count;
+		return (shardNo << INDEX_BITS) | idx;
+	}
+
+	string_view view(uint32_t handle) const			// Lock-free : the entry was written before the handle was handed out.
+	{
+		const Shard& sh = m_shards[handle >> INDEX_BITS];
+		uint32_t idx = handle & ((1u << INDEX_BITS) - 1);
+		const Entry& e = sh.chunks[idx / CHUNK_SIZE].load(memory_order_acquire)[idx % CHUNK_SIZE];
+		return string_view(e.ptr, e.len);
+	}
+
+	size_t bytesUsed()								// Approximate memory held by the pool, for the report below.
+	{
+		size_t total = sizeof(NamePool);
+		for(Shard& sh : m_shards)
+		{
+			shared_lock<shared_mutex> lock(sh.mu);
+			total += sh.blocks.size() * CHAR_BLOCK + sh.hugeBytes;
+			total += (sh.count + CHUNK_SIZE - 1) / CHUNK_SIZE * CHUNK_SIZE * sizeof(Entry);
+			total += sh.index.size() * (sizeof(string_view) + sizeof(uint32_t) + 2 * sizeof(void*)) + sh.index.bucket_count() * sizeof(void*);
+		}
+		return total;
+	}
+};
+
+class Name											// 4-byte handle to an interned name
+{
+private:
+	uint32_t m_id;
+public:
+	Name(string_view s):m_id(NamePool::instance().intern(s)) {}		// Implicit on purpose : Cat c("Smokey") keeps working.
+
+	string_view view() const { return NamePool::instance().view(m_id); }
+	uint32_t id() const { return m_id; }
+
+	friend bool operator==(Name a, Name b) { return a.m_id == b.m_id; }
+	friend bool operator!=(Name a, Name b) { return a.m_id != b.m_id; }
+	friend ostream& operator<<(ostream& os, Name n) { return os<<n.view(); }
+};
+
+static_assert(sizeof(Name) == 4, "Name must stay a 4-byte handle");
+
+// ------------------
+// File :- Cat.cpp
+// ------------------
+
+class Cat
+{
+private:
+	Name _name;										// was : string _name;
+
+public:
+	void meow()
+	{
+		cout<<"Cat rules! My name is "<<_name<<endl;
+	}
+
+	Cat(const char *name):_name(name) {}
+};
+
+// ------------------
+// File :- Dog.cpp			(Dog from 15_Define_Implicit_Type_Conversion.cpp)
+// ------------------
+
+class Dog
+{
+private:
+	Name m_name;									// was : string m_name;
+public:
+	explicit Dog(string_view name):m_name(name) {}
+	string_view getName() const { return m_name.view(); }
+	bool sameName(const Dog& rhs) const { return m_name == rhs.m_name; }		// O(1)
+};
+
+// ------------------
+// File :- Person.cpp		(Person from 13_Resource_Managing_Class.cpp)
+// ------------------
+
+class Person
+{
+private:
+	Name m_name;									// was : string* pName; No ownership, so the compiler generated copy
+													// constructor and copy assignment are correct (Example 1's crash is gone).
+public:
+	explicit Person(string_view name):m_name(name) {}
+	void printName() const { cout<<m_name; }
+};
+
+// ------------------
+// File :- main.cpp
+// ------------------
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10000000;		// objects
+	const size_t DISTINCT = 5000;													// distinct names
+	const unsigned THREADS = max(1u, thread::hardware_concurrency());
+
+	vector<string> names;
+	for(size_t i = 0; i < DISTINCT; ++i)
+		names.push_back("Name number " + to_string(i) + (i % 3 ? "" : " of the long family line"));
+
+	// Memory : N Persons with a string member vs N Persons with a Name member.
+	size_t stringBytes = 0;
+	for(size_t i = 0; i < N; ++i)
+	{
+		const string& s = names[i % DISTINCT];
+		stringBytes += sizeof(string) + (s.size() > 15 ? s.size() + 1 : 0);	// libstdc++ : 15 chars fit in the string itself
+	}
+	vector<Person> persons;
+	persons.reserve(N);
+	for(size_t i = 0; i < N; ++i)
+		persons.emplace_back(names[i % DISTINCT]);
+	size_t nameBytes = N * sizeof(Name) + NamePool::instance().bytesUsed();
+	cout<<"string members : "<<stringBytes / (1 << 20)<<" MB"<<endl;
+	cout<<"Name handles   : "<<nameBytes / (1 << 20)<<" MB (including the pool)"<<endl;
+
+	// Throughput under contention : every thread looks up the same names (hits), then inserts its own new ones (misses).
+	auto run = [&](const char* label, auto body)
+	{
+		auto start = chrono::steady_clock::now();
+		vector<thread> workers;
+		for(unsigned t = 0; t < THREADS; ++t)
+			workers.emplace_back(body, t);
+		for(thread& w : workers)
+			w.join();
+		double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		cout<<label<<" : "<<N / sec / 1e6<<" M ops/sec on "<<THREADS<<" threads"<<endl;
+	};
+
+	const size_t PER_THREAD = N / THREADS;
+	atomic<uint64_t> sink(0);
+	run("lookup (hit) ", [&](unsigned t)
+	{
+		uint64_t acc = 0;
+		for(size_t i = 0; i < PER_THREAD; ++i)
+			acc += Name(names[(i * 7 + t) % DISTINCT]).id();
+		sink += acc;
+	});
+	run("insert (miss)", [&](unsigned t)
+	{
+		uint64_t acc = 0;
+		string s = "thread " + to_string(t) + " name ";
+		size_t base = s.size();
+		for(size_t i = 0; i < PER_THREAD; ++i)
+		{
+			s.resize(base);
+			s += to_string(i);
+			acc += Name(s).id();
+		}
+		sink += acc;
+	});
+
+	// Edge cases : an empty name, and a name bigger than a block followed by ordinary ones.
+	Name empty{ string_view() };
+	string huge(100000, 'x');
+	Name big(huge);
+	Name after("Stored after the huge name");
+	cout<<"empty name : \""<<empty<<"\", huge name intact : "<<(big.view() == huge)<<", next name : "<<after<<endl;
+
+	Cat c("Smokey");
+	c.meow();
+	return static_cast<int>(sink.load() & 0);
+}
+
+// Output (g++ -O2, N = 10M, 5000 distinct names, numbers vary by machine) :-
+//		string members : 521 MB
+//		Name handles   : 41 MB (including the pool)
+//		empty name : "", huge name intact : 1, next name : Stored after the huge name
+//		Lookups scale with the number of threads since they only take shared locks; inserts scale as long as the threads
+//		land on different shards.
@@ -65,3 +65,1066 @@ int main()
 
 	return 0;
 }
+
+
+
+
+/****************************************************** EXAMPLE 2 ******************************************************************/
+
+// Struct of arrays :- a columnar table for lots of Person_t
+
+// Person_t is the right thing for one person. For tens of millions of them, vector<Person_t> is an "array of structs" :
+// every element is a 32-byte string plus a 4-byte age (40 bytes with padding). A scan that only looks at the age still
+// pulls the whole 40 bytes of every person through the cache, i.e. 90% of the memory traffic is wasted.
+//
+// PersonTable keeps each field in its own contiguous column :-
+//		ages    : uint32_t[n]				(a scan over ages reads 4 bytes per person, and can use SIMD)
+//		offsets : uint64_t[n + 1]			(name i is bytes[offsets[i] .. offsets[i + 1]])
+//		bytes   : char[]					(all names back to back)
+// It is still a passive data container, so by the convention above it would be a struct; it is a class only because it
+// has to keep its three columns consistent with each other.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+struct Person_t
+{
+	string name;
+	unsigned int age;
+};
+
+class PersonTable
+{
+private:
+	vector<uint32_t> m_ages;
+	vector<uint64_t> m_offsets{ 0 };
+	vector<char> m_bytes;
+
+public:
+	class Row									// Person_t-like read access to one row, without building a Person_t
+	{
+	private:
+		const PersonTable* m_table;
+		size_t m_row;
+	public:
+		Row(const PersonTable* t, size_t row):m_table(t), m_row(row) {}
+		string_view name() const
+		{
+			const uint64_t* off = m_table->m_offsets.data() + m_row;
+			return string_view(m_table->m_bytes.data() + off[0], off[1] - off[0]);
+		}
+		unsigned int age() const { return m_table->m_ages[m_row]; }
+		operator Person_t() const { return Person_t{ string(name()), age() }; }	// Explicit copy out, when really needed
+	};
+
+	PersonTable() {}
+
+	explicit PersonTable(const vector<Person_t>& persons)
+	{
+		size_t total = 0;
+		for(const Person_t& p : persons)
+			total += p.name.size();
+		reserve(persons.size(), total);
+		for(const Person_t& p : persons)
+			push_back(p.name, p.age);
+	}
+
+	void reserve(size_t rows, size_t nameBytes)
+	{
+		m_ages.reserve(rows);
+		m_offsets.reserve(rows + 1);
+		m_bytes.reserve(nameBytes);
+	}
+
+	void push_back(string_view name, unsigned int age)
+	{
+		m_bytes.insert(m_bytes.end(), name.begin(), name.end());
+		m_offsets.push_back(m_bytes.size());
+		m_ages.push_back(age);
+	}
+
+	size_t size() const { return m_ages.size(); }
+	Row operator[](size_t row) const { return Row(this, row); }
+	const uint32_t* ages() const { return m_ages.data(); }
+
+	size_t count(unsigned lo, unsigned hi) const		// number of rows with lo <= age <= hi
+	{
+		// Branch-free : "age - lo <= hi - lo" in unsigned arithmetic is the whole range check. The compiler turns
+		// this loop into SIMD compares and adds at -O2/-O3. An empty range (lo > hi) would wrap around, so it is done first.
+		if(lo > hi)
+			return 0;
+		const uint32_t* a = m_ages.data();
+		const uint32_t width = hi - lo;
+		size_t n = 0;
+		for(size_t i = 0, e = m_ages.size(); i < e; ++i)
+			n += (a[i] - lo) <= width;
+		return n;
+	}
+
+	double avg() const									// average age over all rows
+	{
+		const uint32_t* a = m_ages.data();
+		uint64_t sum = 0;
+		for(size_t i = 0, e = m_ages.size(); i < e; ++i)
+			sum += a[i];
+		return m_ages.empty() ? 0.0 : double(sum) / m_ages.size();
+	}
+
+	vector<uint32_t> filter_age(unsigned lo, unsigned hi) const	// row ids with lo <= age <= hi, in order
+	{
+		if(lo > hi)										// empty range : "hi - lo" below would wrap around
+			return {};
+		const uint32_t* a = m_ages.data();
+		const size_t n = m_ages.size();
+		vector<uint32_t> rows(n);						// worst case, shrunk at the end
+		uint32_t* out = rows.data();
+		size_t k = 0, i = 0;
+
+#ifdef __AVX2__
+		// 8 ages at a time : clamp to [lo, hi], the lanes that did not change are in range. movemask gives one bit per lane.
+		const __m256i vlo = _mm256_set1_epi32(static_cast<int>(lo));
+		const __m256i vhi = _mm256_set1_epi32(static_cast<int>(hi));
+		for(; i + 8 <= n; i += 8)
+		{
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+			__m256i clamped = _mm256_min_epu32(_mm256_max_epu32(v, vlo), vhi);
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, clamped))));
+			while(mask)
+			{
+				out[k++] = static_cast<uint32_t>(i + __builtin_ctz(mask));
+				mask &= mask - 1;
+			}
+		}
+#endif
+		// Portable tail (and the whole scan without AVX2) : always write, only advance k on a match. No branch to mispredict.
+		const uint32_t width = hi - lo;
+		for(; i < n; ++i)
+		{
+			out[k] = static_cast<uint32_t>(i);
+			k += (a[i] - lo) <= width;
+		}
+		rows.resize(k);
+		return rows;
+	}
+};
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000000;
+	const char* names[] = { "George", "Bob", "Henry", "Elizabeth", "Alexander the Great of Macedonia" };
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	vector<Person_t> aos;
+	aos.reserve(N);
+	uint32_t seed = 12345;
+	for(size_t i = 0; i < N; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		aos.push_back(Person_t{ names[i % 5], (seed >> 16) % 100 });
+	}
+	PersonTable soa(aos);
+
+	// Array of structs
+	auto t0 = clk::now();
+	size_t cnt = 0;
+	for(const Person_t& p : aos)
+		cnt += (p.age >= 20 && p.age <= 40);
+	auto t1 = clk::now();
+	uint64_t sum = 0;
+	for(const Person_t& p : aos)
+		sum += p.age;
+	auto t2 = clk::now();
+	vector<uint32_t> hits;
+	for(size_t i = 0; i < aos.size(); ++i)
+		if(aos[i].age >= 20 && aos[i].age <= 40)
+			hits.push_back(static_cast<uint32_t>(i));
+	auto t3 = clk::now();
+	cout<<"vector<Person_t> : count "<<ms(t0, t1)<<" ms, avg "<<ms(t1, t2)<<" ms, filter "<<ms(t2, t3)<<" ms ("
+		<<cnt<<", "<<double(sum) / N<<", "<<hits.size()<<")"<<endl;
+
+	// Struct of arrays
+	t0 = clk::now();
+	cnt = soa.count(20, 40);
+	t1 = clk::now();
+	double avg = soa.avg();
+	t2 = clk::now();
+	vector<uint32_t> rows = soa.filter_age(20, 40);
+	t3 = clk::now();
+	cout<<"PersonTable      : count "<<ms(t0, t1)<<" ms, avg "<<ms(t1, t2)<<" ms, filter "<<ms(t2, t3)<<" ms ("
+		<<cnt<<", "<<avg<<", "<<rows.size()<<")"<<endl;
+
+	if(!rows.empty())
+	{
+		PersonTable::Row r = soa[rows.front()];
+		cout<<"First match : "<<r.name()<<", "<<r.age()<<endl;
+	}
+	return 0;
+}
+
+// Output (g++ -O3 -mavx2, N = 20M, numbers vary by machine) :-
+//		count and avg over the age column are roughly 5-10x faster than over vector<Person_t> : 10x less memory to read,
+//		and the loop is vectorized. filter_age() gains less because it also has to write out the matching row ids.
+//
+// Note :-
+//		The price of struct of arrays is that "one whole person" is now spread over three places. Row gives back
+//		Person_t-like access, but code that mostly works on whole persons, one at a time, is better off with Person_t.
+
+
+
+
+/****************************************************** EXAMPLE 3 ******************************************************************/
+
+// A binary snapshot of Person_t records that can be used straight from a memory-mapped file (POSIX mmap).
+
+// Loading Person_t records from text means, for every row : read a line, split it, parse the age, and allocate a string
+// for the name. With tens of millions of rows that is most of the startup time.
+// A snapshot stores the same data the way PersonTable (Example 2) keeps it in memory, so opening it is just mmap() :
+//
+//		SnapshotHeader							(64 bytes : magic, version, row count, where each column starts)
+//		ages       : uint32_t[rows]				(padded to 8 bytes)
+//		offsets    : uint64_t[rows + 1]			(name i is heap[offsets[i] .. offsets[i + 1]])
+//		heap       : char[]						(all names back to back)
+//
+// PersonSnapshot maps the file read-only and hands out string_views that point into the mapping. Nothing is parsed and
+// nothing is allocated per row; the OS only reads the pages that are actually touched.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Person_t
+{
+	string name;
+	unsigned int age;
+};
+
+struct SnapshotHeader							// Fixed layout, little-endian, 64 bytes
+{
+	char magic[8];								// "PERSNAP\0"
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t rows;
+	uint64_t agesOffset;						// byte offsets from the start of the file
+	uint64_t namesOffset;
+	uint64_t heapOffset;
+	uint64_t heapSize;
+	uint64_t fileSize;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header layout must not change");
+
+static const char SNAPSHOT_MAGIC[8] = { 'P', 'E', 'R', 'S', 'N', 'A', 'P', '\0' };
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+inline uint64_t alignUp8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+void writeSnapshot(const string& path, const vector<Person_t>& persons)
+{
+	SnapshotHeader h = {};
+	memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+	h.version = SNAPSHOT_VERSION;
+	h.rows = persons.size();
+	h.agesOffset = sizeof(SnapshotHeader);
+	h.namesOffset = alignUp8(h.agesOffset + h.rows * sizeof(uint32_t));
+	h.heapOffset = h.namesOffset + (h.rows + 1) * sizeof(uint64_t);
+	for(const Person_t& p : persons)
+		h.heapSize += p.name.size();
+	h.fileSize = h.heapOffset + h.heapSize;
+
+	ofstream out(path, ios::binary | ios::trunc);
+	if(!out)
+		throw runtime_error("cannot create " + path);
+
+	vector<uint32_t> ages;
+	ages.reserve(persons.size());
+	for(const Person_t& p : persons)
+		ages.push_back(p.age);
+	vector<uint64_t> offsets;
+	offsets.reserve(persons.size() + 1);
+	offsets.push_back(0);
+	for(const Person_t& p : persons)
+		offsets.push_back(offsets.back() + p.name.size());
+
+	const char pad[8] = {};
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	out.write(reinterpret_cast<const char*>(ages.data()), ages.size() * sizeof(uint32_t));
+	out.write(pad, h.namesOffset - (h.agesOffset + h.rows * sizeof(uint32_t)));
+	out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+	for(const Person_t& p : persons)
+		out.write(p.name.data(), p.name.size());
+	if(!out.flush())
+		throw runtime_error("write failed : " + path);
+}
+
+class PersonSnapshot							// Read-only view of a snapshot file. Owns the mapping (RAII, see lesson 10).
+{
+private:
+	const char* m_base = nullptr;
+	size_t m_size = 0;
+	const SnapshotHeader* m_header = nullptr;
+	const uint32_t* m_ages = nullptr;
+	const uint64_t* m_offsets = nullptr;
+	const char* m_heap = nullptr;
+
+	PersonSnapshot(const PersonSnapshot&) = delete;				// Disallow copying : only one owner of the mapping
+	PersonSnapshot& operator=(const PersonSnapshot&) = delete;
+
+public:
+	explicit PersonSnapshot(const string& path)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+			throw runtime_error("cannot open " + path);
+		struct stat st;
+		if(::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader)))
+		{
+			::close(fd);
+			throw runtime_error("not a snapshot : " + path);
+		}
+		m_size = static_cast<size_t>(st.st_size);
+		void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);							// The mapping keeps the file alive.
+		if(p == MAP_FAILED)
+			throw runtime_error("mmap failed : " + path);
+		m_base = static_cast<const char*>(p);
+
+		m_header = reinterpret_cast<const SnapshotHeader*>(m_base);
+		const SnapshotHeader& h = *m_header;
+		bool ok = memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) == 0
+			&& h.version == SNAPSHOT_VERSION
+			&& h.fileSize == m_size
+			&& h.agesOffset == sizeof(SnapshotHeader)
+			&& h.rows <= (m_size - h.agesOffset) / sizeof(uint32_t)
+			&& h.namesOffset == alignUp8(h.agesOffset + h.rows * sizeof(uint32_t))
+			&& h.namesOffset <= m_size
+			&& h.heapOffset == h.namesOffset + (h.rows + 1) * sizeof(uint64_t)
+			&& h.heapOffset <= m_size				// checked before the subtraction below, which must not wrap
+			&& h.heapSize == m_size - h.heapOffset;
+		if(ok)									// The offsets table is in the file now : its ends must match the heap.
+		{
+			const uint64_t* offsets = reinterpret_cast<const uint64_t*>(m_base + h.namesOffset);
+			ok = offsets[0] == 0 && offsets[h.rows] == h.heapSize;
+		}
+		if(!ok)
+		{
+			::munmap(const_cast<char*>(m_base), m_size);
+			throw runtime_error("corrupt or incompatible snapshot : " + path);
+		}
+		m_ages = reinterpret_cast<const uint32_t*>(m_base + h.agesOffset);
+		m_offsets = reinterpret_cast<const uint64_t*>(m_base + h.namesOffset);
+		m_heap = m_base + h.heapOffset;
+	}
+
+	~PersonSnapshot()
+	{
+		::munmap(const_cast<char*>(m_base), m_size);
+	}
+
+	size_t size() const { return m_header->rows; }
+	unsigned int age(size_t row) const { return m_ages[row]; }
+	string_view name(size_t row) const
+	{
+		return string_view(m_heap + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+	}
+	const uint32_t* ages() const { return m_ages; }
+};
+
+// Note :-
+//		The offsets are only trusted as far as the header checks go (the first is 0, the last is heapSize). A snapshot from
+//		an untrusted source should also be checked for offsets[i] <= offsets[i + 1] before name() is used.
+
+vector<Person_t> loadText(const string& path)	// The current path : parse "name,age" lines and construct a Person_t each.
+{
+	vector<Person_t> persons;
+	ifstream in(path);
+	string line;
+	while(getline(in, line))
+	{
+		size_t comma = line.rfind(',');
+		persons.push_back(Person_t{ line.substr(0, comma), static_cast<unsigned>(stoul(line.substr(comma + 1))) });
+	}
+	return persons;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 50000000;
+	const char* names[] = { "George", "Bob", "Henry", "Elizabeth", "Alexander the Great of Macedonia" };
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	{
+		vector<Person_t> persons;
+		persons.reserve(N);
+		for(size_t i = 0; i < N; ++i)
+			persons.push_back(Person_t{ names[i % 5], static_cast<unsigned>(i % 100) });
+		ofstream text("persons.csv");
+		for(const Person_t& p : persons)
+			text<<p.name<<','<<p.age<<'\n';
+		writeSnapshot("persons.snap", persons);
+	}
+
+	// For a real cold start, drop the page cache between runs (echo 3 > /proc/sys/vm/drop_caches, needs root).
+	auto t0 = clk::now();
+	vector<Person_t> parsed = loadText("persons.csv");
+	uint64_t sum1 = 0;
+	for(const Person_t& p : parsed)
+		sum1 += p.age + p.name.size();
+	auto t1 = clk::now();
+
+	PersonSnapshot snap("persons.snap");
+	uint64_t sum2 = 0;
+	for(size_t i = 0; i < snap.size(); ++i)
+		sum2 += snap.age(i) + snap.name(i).size();
+	auto t2 = clk::now();
+
+	cout<<"parse and construct : "<<ms(t0, t1)<<" ms ("<<sum1<<")"<<endl;
+	cout<<"mmap snapshot       : "<<ms(t1, t2)<<" ms ("<<sum2<<")"<<endl;
+
+	remove("persons.csv");
+	remove("persons.snap");
+	return 0;
+}
+
+// Output (g++ -O2, N = 50M, warm page cache, numbers vary by machine) :-
+//		Opening the snapshot and touching every row is one to two orders of magnitude faster than parsing, and uses no heap
+//		memory for the rows at all. Code that only needs a few rows (or only the ages) pays only for the pages it touches.
+
+
+
+
+/****************************************************** EXAMPLE 4 ******************************************************************/
+
+// Streaming CSV / TSV ingest into Person_t or PersonTable, in bounded memory.
+
+// The usual loader is "while(getline(in, line)) { split; stoul; push_back(Person_t{...}); }". Per row that is an istream
+// call, two temporary strings, a locale-aware integer parse and a string allocation for the name.
+// CsvPersonLoader instead :-
+//		1) reads the file in fixed-size chunks (say 4MB) and cuts each chunk after its last '\n', carrying the partial line
+//		   over to the next chunk. At most 'maxInFlight' chunks exist at any time, so memory stays bounded no matter how
+//		   big the file is.
+//		2) parses each chunk on its own thread. Delimiters and newlines are found 16 bytes at a time with SSE2 (a compare
+//		   and a movemask give one bit per interesting byte), with a portable scalar fallback.
+//		3) parses the age with a fixed-length, branch-free loop instead of stoul().
+//		4) appends each row straight into a PersonTable batch (columnar, see Example 2) : no std::string per row.
+//		5) hands the batches to the caller's sink in file order. The sink can append them to one big PersonTable or
+//		   vector<Person_t>, or just aggregate them when the data does not fit in memory.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+struct Person_t
+{
+	string name;
+	unsigned int age;
+};
+
+class PersonTable								// Example 2, reduced to what the loader needs
+{
+private:
+	vector<uint32_t> m_ages;
+	vector<uint64_t> m_offsets{ 0 };
+	vector<char> m_bytes;
+
+public:
+	void push_back(string_view name, unsigned int age)
+	{
+		m_bytes.insert(m_bytes.end(), name.begin(), name.end());
+		m_offsets.push_back(m_bytes.size());
+		m_ages.push_back(age);
+	}
+
+	void append(const PersonTable& rhs)			// Bulk append of a whole batch : three vector inserts
+	{
+		uint64_t base = m_bytes.size();
+		m_bytes.insert(m_bytes.end(), rhs.m_bytes.begin(), rhs.m_bytes.end());
+		for(size_t i = 1; i < rhs.m_offsets.size(); ++i)
+			m_offsets.push_back(base + rhs.m_offsets[i]);
+		m_ages.insert(m_ages.end(), rhs.m_ages.begin(), rhs.m_ages.end());
+	}
+
+	void reserve(size_t rows, size_t nameBytes)
+	{
+		m_ages.reserve(rows);
+		m_offsets.reserve(rows + 1);
+		m_bytes.reserve(nameBytes);
+	}
+
+	size_t size() const { return m_ages.size(); }
+	unsigned int age(size_t row) const { return m_ages[row]; }
+	string_view name(size_t row) const
+	{
+		return string_view(m_bytes.data() + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+	}
+};
+
+class CsvPersonLoader
+{
+private:
+	static const size_t PADDING = 16;			// Every chunk buffer has 16 readable bytes after its end, so the SIMD
+												// scan and the age parser never need a bounds check.
+	size_t m_chunkBytes;
+	unsigned m_maxInFlight;
+	char m_delim;
+
+	// One bit per byte of p[0..15] that is either the delimiter or '\n'.
+	static unsigned structuralMask(const char* p, char delim)
+	{
+#ifdef __SSE2__
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(delim)), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+		return static_cast<unsigned>(_mm_movemask_epi8(hit));
+#else
+		unsigned mask = 0;
+		for(unsigned k = 0; k < 16; ++k)
+			mask |= unsigned(p[k] == delim || p[k] == '\n') << k;
+		return mask;
+#endif
+	}
+
+	// Up to 4 digits, no branches : bytes past 'len' are read (they are padding or the rest of the line) but ignored.
+	static unsigned parseAge(const char* s, size_t len, bool& ok)
+	{
+		unsigned v = 0;
+		bool good = (len - 1) < 4;				// 1 <= len <= 4
+		for(size_t k = 0; k < 4; ++k)
+		{
+			unsigned d = static_cast<unsigned char>(s[k]) - unsigned('0');
+			bool in = k < len;
+			good &= !in | (d <= 9);
+			v = in ? v * 10 + d : v;
+		}
+		ok = good;
+		return v;
+	}
+
+	static void addRow(const char* p, size_t lineStart, size_t delimPos, size_t lineEnd, char delim, PersonTable& out, size_t& bad)
+	{
+		lineEnd -= (lineEnd > lineStart && p[lineEnd - 1] == '\r');		// Windows line endings
+		if(delimPos >= lineEnd)												// no delimiter on this line
+		{
+			bad += (lineEnd > lineStart);									// (empty lines are just skipped)
+			return;
+		}
+		size_t ageEnd = delimPos + 1;
+		while(ageEnd < lineEnd && p[ageEnd] != delim)						// ignore any further columns
+			++ageEnd;
+		bool ok;
+		unsigned age = parseAge(p + delimPos + 1, ageEnd - delimPos - 1, ok);
+		if(ok)
+			out.push_back(string_view(p + lineStart, delimPos - lineStart), age);
+		else
+			++bad;
+	}
+
+	// p[0..n) holds whole lines, the last one ending in '\n'. p[n..n + PADDING) is readable.
+	static void parseChunk(const char* p, size_t n, char delim, PersonTable& out, size_t& bad)
+	{
+		const size_t NONE = size_t(-1);
+		size_t lineStart = 0;
+		size_t delimPos = NONE;
+		out.reserve(n / 4, n);							// a row is at least "x,1\n" : never reallocates
+		for(size_t i = 0; i < n; i += 16)
+		{
+			unsigned mask = structuralMask(p + i, delim);
+			if(n - i < 16)
+				mask &= (1u << (n - i)) - 1;			// don't look at the padding
+			while(mask)
+			{
+				size_t pos = i + __builtin_ctz(mask);
+				mask &= mask - 1;
+				if(p[pos] == '\n')
+				{
+					addRow(p, lineStart, delimPos, pos, delim, out, bad);
+					lineStart = pos + 1;
+					delimPos = NONE;
+				}
+				else if(delimPos == NONE)
+					delimPos = pos;
+			}
+		}
+	}
+
+public:
+	explicit CsvPersonLoader(char delim = ',', size_t chunkBytes = 4 << 20, unsigned threads = thread::hardware_concurrency())
+		:m_chunkBytes(chunkBytes), m_maxInFlight(2 * max(1u, threads)), m_delim(delim) {}
+
+	// Calls sink(const PersonTable& batch) once per chunk, in file order. Returns the number of rows that failed to parse.
+	template <typename Sink>
+	size_t load(const string& path, Sink sink)
+	{
+		FILE* f = fopen(path.c_str(), "rb");
+		if(!f)
+			throw runtime_error("cannot open " + path);
+
+		struct Result { PersonTable rows; size_t bad = 0; };
+		deque<future<Result>> inFlight;
+		size_t bad = 0;
+		string carry;							// partial last line of the previous chunk
+
+		auto drainOne = [&]()
+		{
+			Result r = inFlight.front().get();	// rethrows if the parser threw
+			inFlight.pop_front();
+			bad += r.bad;
+			sink(static_cast<const PersonTable&>(r.rows));
+		};
+
+		try
+		{
+			for(;;)
+			{
+				vector<char> buf(carry.size() + m_chunkBytes + 1 + PADDING);
+				memcpy(buf.data(), carry.data(), carry.size());
+				size_t got = fread(buf.data() + carry.size(), 1, m_chunkBytes, f);
+				size_t n = carry.size() + got;
+				bool eof = got < m_chunkBytes;
+
+				size_t cut;
+				if(eof)
+				{
+					if(n && buf[n - 1] != '\n')
+						buf[n++] = '\n';		// last line without a newline
+					cut = n;
+				}
+				else
+				{
+					const char* lastNl = static_cast<const char*>(memrchr(buf.data(), '\n', n));
+					cut = lastNl ? size_t(lastNl - buf.data()) + 1 : 0;	// a line longer than a chunk : keep reading
+				}
+				carry.assign(buf.data() + cut, n - cut);
+
+				if(cut)
+				{
+					if(inFlight.size() >= m_maxInFlight)
+						drainOne();				// bounded memory : wait for the oldest chunk before reading more
+					char delim = m_delim;
+					inFlight.push_back(async(launch::async, [b = std::move(buf), cut, delim]()
+					{
+						Result r;
+						parseChunk(b.data(), cut, delim, r.rows, r.bad);
+						return r;
+					}));
+				}
+				if(eof)
+					break;
+			}
+			while(!inFlight.empty())
+				drainOne();
+		}
+		catch(...)
+		{
+			fclose(f);							// the futures' destructors wait for their threads
+			throw;
+		}
+		fclose(f);
+		return bad;
+	}
+};
+
+vector<Person_t> loadWithIostream(const string& path)	// The line-by-line loader, for comparison
+{
+	vector<Person_t> persons;
+	ifstream in(path);
+	string line;
+	while(getline(in, line))
+	{
+		size_t comma = line.find(',');
+		persons.push_back(Person_t{ line.substr(0, comma), static_cast<unsigned>(stoul(line.substr(comma + 1))) });
+	}
+	return persons;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000000;
+	const char* names[] = { "George", "Bob", "Henry", "Elizabeth", "Alexander the Great of Macedonia" };
+	using clk = chrono::steady_clock;
+
+	size_t fileBytes = 0;
+	{
+		ofstream out("persons.csv", ios::binary);
+		for(size_t i = 0; i < N; ++i)
+		{
+			string line = string(names[i % 5]) + ',' + to_string(i % 100) + '\n';
+			fileBytes += line.size();
+			out<<line;
+		}
+	}
+	auto report = [&](const char* label, clk::time_point t0, size_t rows)
+	{
+		double sec = chrono::duration<double>(clk::now() - t0).count();
+		cout<<label<<" : "<<fileBytes / sec / 1e9<<" GB/s ("<<rows<<" rows)"<<endl;
+	};
+
+	auto t0 = clk::now();
+	vector<Person_t> viaStream = loadWithIostream("persons.csv");
+	report("getline + stoul -> vector<Person_t>  ", t0, viaStream.size());
+	viaStream = vector<Person_t>();
+
+	CsvPersonLoader loader;
+
+	t0 = clk::now();
+	PersonTable table;
+	loader.load("persons.csv", [&](const PersonTable& batch) { table.append(batch); });
+	report("CsvPersonLoader -> PersonTable        ", t0, table.size());
+
+	t0 = clk::now();
+	vector<Person_t> persons;
+	loader.load("persons.csv", [&](const PersonTable& batch)
+	{
+		for(size_t i = 0; i < batch.size(); ++i)
+			persons.push_back(Person_t{ string(batch.name(i)), batch.age(i) });
+	});
+	report("CsvPersonLoader -> vector<Person_t>   ", t0, persons.size());
+
+	t0 = clk::now();
+	uint64_t rows = 0, ageSum = 0;				// Bounded memory : nothing is kept, so this works on files larger than RAM
+	loader.load("persons.csv", [&](const PersonTable& batch)
+	{
+		rows += batch.size();
+		for(size_t i = 0; i < batch.size(); ++i)
+			ageSum += batch.age(i);
+	});
+	report("CsvPersonLoader -> running average    ", t0, rows);
+	cout<<"average age "<<double(ageSum) / rows<<endl;
+
+	remove("persons.csv");
+	return 0;
+}
+
+// Output (g++ -O2, N = 20M rows (~250MB), file in the page cache, numbers vary by machine) :-
+//		On a single core the chunked loader into a PersonTable is about 2x faster than getline + stoul, and about 4x
+//		faster when the sink only aggregates. The SSE2 scan itself runs at several GB/s; the rest is building the rows.
+//		With more cores the parsing runs in parallel, until the sink (which runs on the reading thread) or the disk
+//		becomes the bottleneck. Filling a vector<Person_t> is no faster than getline, because it is back to one string
+//		per row : keep the data columnar as long as possible.
+
+
+
+
+/****************************************************** EXAMPLE 5 ******************************************************************/
+
+// Reports over many Persons : parallel sort by age and name, and parallel group-by age bucket.
+
+// std::sort(persons.begin(), persons.end(), byAge) on one core moves whole Person objects (a string and an unsigned each)
+// around O(n log n) times. For report ordering we never need the objects themselves to move :-
+//		- Sort an array of row indices instead, and read persons[index[i]] in that order.
+//		- Ages are small unsigned integers, so a radix sort (no comparisons, O(n) per 8-bit digit) beats any comparison sort.
+//		  Each thread histograms its own slice, a prefix sum over (digit, thread) gives every thread its own output range,
+//		  and then all threads scatter in parallel. Digits that are the same for every key (e.g. the top 3 bytes of an age)
+//		  are skipped.
+//		- Group-by runs on each thread's slice into a private hash table (no locks, no shared cache lines), and the
+//		  per-thread partial aggregates are merged at the end.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class Person
+{
+	string name_;
+	unsigned int age_;
+
+public:
+	Person(string name, unsigned int age):name_(std::move(name)), age_(age) {}
+
+	unsigned getAge() const { return age_; }
+	const string& getName() const { return name_; }
+};
+
+template <typename F>
+void parallelFor(size_t n, unsigned threads, F f)			// f(threadNo, begin, end) on 'threads' contiguous slices
+{
+	vector<thread> workers;
+	for(unsigned t = 1; t < threads; ++t)
+		workers.emplace_back(f, t, n * t / threads, n * (t + 1) / threads);
+	f(0u, size_t(0), n / threads);
+	for(thread& w : workers)
+		w.join();
+}
+
+// Stable LSD radix sort of 'index' by keys[index[i]]. 'keys' is indexed by row, 'index' is a permutation of rows.
+void parallelRadixSort(const vector<uint32_t>& keys, vector<uint32_t>& index, unsigned threads)
+{
+	const size_t n = index.size();
+	uint32_t allOr = 0, allAnd = ~0u;
+	for(uint32_t k : keys)
+	{
+		allOr |= k;
+		allAnd &= k;
+	}
+
+	// Sort (key, row) pairs rather than rows, so each pass reads keys sequentially instead of through the index.
+	vector<uint64_t> cur(n), next(n);
+	parallelFor(n, threads, [&](unsigned, size_t b, size_t e)
+	{
+		for(size_t i = b; i < e; ++i)
+			cur[i] = (uint64_t(keys[index[i]]) << 32) | index[i];
+	});
+
+	vector<size_t> hist(size_t(threads) * 256);
+	for(unsigned shift = 32; shift < 64; shift += 8)
+	{
+		if((((allOr ^ allAnd) >> (shift - 32)) & 0xFF) == 0)	// every key has the same digit here : nothing to do
+			continue;
+
+		fill(hist.begin(), hist.end(), 0);
+		parallelFor(n, threads, [&](unsigned t, size_t b, size_t e)
+		{
+			size_t* h = &hist[size_t(t) * 256];
+			for(size_t i = b; i < e; ++i)
+				++h[(cur[i] >> shift) & 0xFF];
+		});
+
+		size_t sum = 0;											// digit-major, thread-minor : keeps the sort stable
+		for(unsigned d = 0; d < 256; ++d)
+			for(unsigned t = 0; t < threads; ++t)
+			{
+				size_t c = hist[size_t(t) * 256 + d];
+				hist[size_t(t) * 256 + d] = sum;
+				sum += c;
+			}
+
+		parallelFor(n, threads, [&](unsigned t, size_t b, size_t e)
+		{
+			size_t* pos = &hist[size_t(t) * 256];
+			for(size_t i = b; i < e; ++i)
+				next[pos[(cur[i] >> shift) & 0xFF]++] = cur[i];
+		});
+		cur.swap(next);
+	}
+
+	parallelFor(n, threads, [&](unsigned, size_t b, size_t e)
+	{
+		for(size_t i = b; i < e; ++i)
+			index[i] = static_cast<uint32_t>(cur[i]);
+	});
+}
+
+// Row order by (age, name) : sort by name first (comparison sort on slices, then merged), then a stable radix sort by age.
+vector<uint32_t> orderByAgeThenName(const vector<Person>& persons, unsigned threads)
+{
+	const size_t n = persons.size();
+	vector<uint32_t> index(n);
+	vector<uint32_t> ages(n);
+	parallelFor(n, threads, [&](unsigned, size_t b, size_t e)
+	{
+		for(size_t i = b; i < e; ++i)
+		{
+			index[i] = static_cast<uint32_t>(i);
+			ages[i] = persons[i].getAge();
+		}
+	});
+
+	auto byName = [&](uint32_t a, uint32_t b) { return persons[a].getName() < persons[b].getName(); };
+	vector<size_t> bounds;
+	for(unsigned t = 0; t <= threads; ++t)
+		bounds.push_back(n * t / threads);
+	parallelFor(n, threads, [&](unsigned t, size_t, size_t)
+	{
+		stable_sort(index.begin() + bounds[t], index.begin() + bounds[t + 1], byName);
+	});
+	for(size_t width = 1; width < threads; width *= 2)		// merge neighbouring slices, in parallel at each level
+	{
+		vector<thread> mergers;
+		for(size_t t = 0; t + width < threads; t += 2 * width)
+		{
+			size_t lo = bounds[t], mid = bounds[t + width], hi = bounds[min<size_t>(t + 2 * width, threads)];
+			mergers.emplace_back([&, lo, mid, hi]() { inplace_merge(index.begin() + lo, index.begin() + mid, index.begin() + hi, byName); });
+		}
+		for(thread& m : mergers)
+			m.join();
+	}
+
+	parallelRadixSort(ages, index, threads);
+	return index;
+}
+
+struct AgeGroup
+{
+	uint32_t bucket;				// e.g. 3 means ages 30..39
+	uint64_t count;
+	uint64_t ageSum;
+	size_t nameBytes;
+};
+
+// Group by (age / bucketWidth). Each thread aggregates into its own small open-addressing hash table.
+vector<AgeGroup> groupByAge(const vector<Person>& persons, unsigned bucketWidth, unsigned threads)
+{
+	struct Table
+	{
+		vector<AgeGroup> slots;
+		vector<bool> used;
+		size_t size = 0;
+
+		Table():slots(64), used(64) {}
+
+		AgeGroup& find(uint32_t bucket)
+		{
+			if(2 * (size + 1) > slots.size())
+				grow();
+			size_t mask = slots.size() - 1;
+			size_t i = (bucket * 0x9E3779B1u) & mask;
+			while(used[i] && slots[i].bucket != bucket)
+				i = (i + 1) & mask;
+			if(!used[i])
+			{
+				used[i] = true;
+				slots[i] = AgeGroup{ bucket, 0, 0, 0 };
+				++size;
+			}
+			return slots[i];
+		}
+
+		void grow()
+		{
+			Table bigger;
+			bigger.slots.resize(slots.size() * 2);
+			bigger.used.resize(slots.size() * 2);
+			for(size_t i = 0; i < slots.size(); ++i)
+				if(used[i])
+					bigger.find(slots[i].bucket) = slots[i];
+			swap(*this, bigger);
+		}
+	};
+
+	vector<Table> partial(threads);
+	parallelFor(persons.size(), threads, [&](unsigned t, size_t b, size_t e)
+	{
+		Table& tab = partial[t];
+		for(size_t i = b; i < e; ++i)
+		{
+			AgeGroup& g = tab.find(persons[i].getAge() / bucketWidth);
+			++g.count;
+			g.ageSum += persons[i].getAge();
+			g.nameBytes += persons[i].getName().size();
+		}
+	});
+
+	Table merged;
+	for(Table& tab : partial)
+		for(size_t i = 0; i < tab.slots.size(); ++i)
+			if(tab.used[i])
+			{
+				AgeGroup& g = merged.find(tab.slots[i].bucket);
+				g.count += tab.slots[i].count;
+				g.ageSum += tab.slots[i].ageSum;
+				g.nameBytes += tab.slots[i].nameBytes;
+			}
+
+	vector<AgeGroup> result;
+	for(size_t i = 0; i < merged.slots.size(); ++i)
+		if(merged.used[i])
+			result.push_back(merged.slots[i]);
+	sort(result.begin(), result.end(), [](const AgeGroup& a, const AgeGroup& b) { return a.bucket < b.bucket; });
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t N = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000000;
+	const unsigned maxThreads = max(1u, thread::hardware_concurrency());
+	const char* names[] = { "George", "Bob", "Henry", "Elizabeth", "Alexander the Great of Macedonia", "Anne", "Zoe" };
+	using clk = chrono::steady_clock;
+	auto ms = [](clk::time_point a, clk::time_point b) { return chrono::duration<double, milli>(b - a).count(); };
+
+	vector<Person> persons;
+	persons.reserve(N);
+	uint32_t seed = 1;
+	for(size_t i = 0; i < N; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		persons.emplace_back(names[(seed >> 8) % 7], (seed >> 16) % 100);
+	}
+
+	auto byAgeName = [](const Person& a, const Person& b)
+	{
+		return a.getAge() != b.getAge() ? a.getAge() < b.getAge() : a.getName() < b.getName();
+	};
+
+	auto t0 = clk::now();
+	vector<Person> copy = persons;
+	auto t1 = clk::now();
+	sort(copy.begin(), copy.end(), byAgeName);
+	auto t2 = clk::now();
+	cout<<"std::sort of objects (1 thread) : "<<ms(t1, t2)<<" ms (+ "<<ms(t0, t1)<<" ms to copy)"<<endl;
+
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		t0 = clk::now();
+		vector<uint32_t> order = orderByAgeThenName(persons, threads);
+		t1 = clk::now();
+		vector<AgeGroup> groups = groupByAge(persons, 10, threads);
+		t2 = clk::now();
+
+		bool same = true;
+		for(size_t i = 0; i < N && same; ++i)
+			same = persons[order[i]].getAge() == copy[i].getAge() && persons[order[i]].getName() == copy[i].getName();
+		cout<<threads<<" thread(s) : order by age, name "<<ms(t0, t1)<<" ms, group by age/10 "<<ms(t1, t2)<<" ms"
+			<<(same ? "" : "  MISMATCH")<<endl;
+		if(threads * 2 > maxThreads)
+			for(const AgeGroup& g : groups)
+				cout<<"\tages "<<g.bucket * 10<<"-"<<g.bucket * 10 + 9<<" : "<<g.count<<" persons, average age "
+					<<double(g.ageSum) / g.count<<endl;
+	}
+	return 0;
+}
+
+// Output (g++ -O2, N = 100M, numbers vary by machine) :-
+//		Ordering by age alone (the radix part) takes a single 8-bit pass, since all ages are below 256. Ordering by name
+//		is comparison based and dominates; both parts scale with the number of cores until memory bandwidth runs out.
+//		The group-by scales almost linearly : each thread only touches its own slice and its own 10-entry table.